@@ -2,3 +2,4 @@ apt-get install arduino
 apt-get install arduino-mk
 apt-get install jq
 apt-get install python3-intelhex
+apt-get install python3-serial
@@ -24,37 +24,63 @@
 #  SOFTWARE.
 
 
-import smbus
 import time
 import argparse
 import sys
 import os
+import struct
+import zlib
+import ctypes
+import fcntl
 from intelhex import IntelHex
 
 FORMAT_BYTE             = 0xFF
 PAYLOAD_SIZE            = 16
+PAGE_SIZE               = 128
 
-FIRMWARE_1_SIZE         = 30720 # 30 Bytes
-FIRMWARE_2_SIZE         = 30720 # 30 Bytes
+FIRMWARE_1_SIZE         = 28672 # 28 KB, flash below the 4 KB boot section
+FIRMWARE_2_SIZE         = 28672 # 28 KB
 CONFIG_SIZE             = 2048  #  2 Bytes
 UNUSED_SIZE             = 2048  #  2 Bytes
 
+I2C_DEVICE              = "/dev/i2c-1"
+I2C_RDWR                = 0x0707  # linux/i2c-dev.h
+I2C_M_RD                = 0x0001
+EEPROM_WRITE_TIMEOUT    = 0.020   # 24LC512 write cycle is 5 ms max
+DUMP_BLOCK_SIZE         = 1024    # One sequential read, i2c-dev takes up to 8192 bytes
+
 OPTION_FORMAT           = "format"
 OPTION_FIRMWARE         = "firmware"
 OPTION_CONFIG           = "config"
 OPTION_DUMP             = "dump"
+OPTION_TIMING           = "timing"
 
 REGION_OPTN_FIRMWARE_1 = "FW1"
 REGION_OPTN_FIRMWARE_2 = "FW2"
 REGION_OPTN_CONFIG     = "CNF"
 REGION_OPTN_UNUSED     = "UNSD"
 
+EEPROM_DUMP_SIZE       = FIRMWARE_1_SIZE + FIRMWARE_2_SIZE + CONFIG_SIZE + UNUSED_SIZE
+DUMP_REGIONS = {
+    REGION_OPTN_FIRMWARE_1 : (0,                                               FIRMWARE_1_SIZE, "_fw_1"),
+    REGION_OPTN_FIRMWARE_2 : (FIRMWARE_1_SIZE,                                 FIRMWARE_2_SIZE, "_fw_2"),
+    REGION_OPTN_CONFIG     : (FIRMWARE_1_SIZE + FIRMWARE_2_SIZE,               CONFIG_SIZE,     "_conf"),
+    REGION_OPTN_UNUSED     : (FIRMWARE_1_SIZE + FIRMWARE_2_SIZE + CONFIG_SIZE, UNUSED_SIZE,     "_unusd"),
+}
+DUMP_REGION_NAMES = {
+    REGION_OPTN_FIRMWARE_1 : "Firmware 1",
+    REGION_OPTN_FIRMWARE_2 : "Firmware 2",
+    REGION_OPTN_CONFIG     : "Config",
+    REGION_OPTN_UNUSED     : "Unused",
+}
+
 FWU_MODE_UNKNOWN        = "UNKNOWN"
 FWU_MODE_ENABLE         = "ENABLE"
 FWU_MODE_DISABLE        = "DISABLE"
 
 FWU_SLOT_1              = '1'
 FWU_SLOT_2              = '2'
+FWU_SLOT_OTHER          = 'A'
 
 HALF_LINE               = '1'
 FULL_LINE               = '2'
@@ -67,6 +93,37 @@ CONFIG_START_ADDRESS    = FIRMWARE_1_SIZE + FIRMWARE_2_SIZE
 CONFIG_FWU_MODE_ADDRESS = CONFIG_START_ADDRESS + 0
 CONFIG_FWU_SLOT_ADDRESS = CONFIG_START_ADDRESS + 1
 CONFIG_FWU_BKUP_ADDRESS = CONFIG_START_ADDRESS + 2
+CONFIG_FWU_MIRROR_ADDRESS = CONFIG_START_ADDRESS + 4
+
+CONFIG_RING_ADDRESS     = CONFIG_START_ADDRESS + 4 * PAGE_SIZE
+CONFIG_RING_SIZE        = 8 * PAGE_SIZE
+CONFIG_RECORD_FORMAT    = "<H5sB"
+CONFIG_RECORD_SIZE      = 8
+CONFIG_RECORD_DATA_SIZE = 5
+
+BOOT_TIMING_ADDRESS     = CONFIG_START_ADDRESS + CONFIG_SIZE
+BOOT_TIMING_SIZE        = 2 * PAGE_SIZE
+BOOT_TIMING_FORMAT      = "<H6HBB"
+BOOT_TIMING_RECORD_SIZE = 16
+BOOT_TIMING_TICK_MS     = 1024 / 16000  # Timer1 at F_CPU / 1024, 16 MHz
+BOOT_TIMING_OVERFLOW    = 0xFFFF
+BOOT_TIMING_PHASES      = ["banner", "config", "verify", "backup", "program", "commit"]
+RESET_FLAGS             = [(0x01, "power-on"), (0x02, "external"), (0x04, "brown-out"), (0x08, "watchdog")]
+
+IMAGE_HEADER_MAGIC      = 0x4269
+IMAGE_HEADER_FORMAT     = "<HHIBBBBHHI"
+IMAGE_FLAG_COMPRESSED   = 0x01
+IMAGE_FLAG_DELTA        = 0x02
+IMAGE_FLAG_OCCUPANCY    = 0x08
+IMAGE_OCCUPANCY_OFFSET  = 32
+
+DELTA_END_PAGE          = 0xFF
+DELTA_MIN_KEEP          = 3
+
+LZ_MIN_MATCH            = 3
+LZ_MAX_MATCH            = LZ_MIN_MATCH + 15
+LZ_WINDOW_SIZE          = 4096
+LZ_MAX_CANDIDATES       = 64
 
 CONFIG_OP_FWU_DEFAULT   = FWU_MODE_ENABLE
 CONFIG_OP_SLOT_DEFAULT  = FWU_SLOT_1
@@ -86,96 +143,209 @@ arg_opt = {
     "region"    : ["-r", "--region"],
     "default"   : ["-D", "--default"],
     "legacy"    : ["-L", "--legacy"],
+    "version"   : ["-v", "--fw_version"],
+    "compress"  : ["-c", "--compress"],
+    "base"      : ["-B", "--base"],
+    "page"      : ["-P", "--page_write"],
+    "compare"   : ["-C", "--compare"],
+    "occupancy" : ["-O", "--occupancy"],
 }
 
 
-bus=smbus.SMBus(1)
+# Opened in main(), so the image helpers can be imported without an I2C bus.
+bus = None
+# Opened on the first page write, see open_i2c_rdwr().
+i2c_file = None
+
+
+class i2c_msg(ctypes.Structure):
+    _fields_ = [("addr", ctypes.c_uint16), ("flags", ctypes.c_uint16),
+                ("len", ctypes.c_uint16), ("buf", ctypes.POINTER(ctypes.c_uint8))]
+
+
+class i2c_rdwr_ioctl_data(ctypes.Structure):
+    _fields_ = [("msgs", ctypes.POINTER(i2c_msg)), ("nmsgs", ctypes.c_uint32)]
+
+
+def open_i2c_rdwr():
+    global i2c_file
+    if i2c_file == None:
+        i2c_file = os.open(I2C_DEVICE, os.O_RDWR)
+    return i2c_file
 
-def dump_eeprom_to_intel_hex(file_path, eeprom_data, line_length):
-    if line_length == HALF_LINE:
-        byte_count = 16
-    else:
-        byte_count = 32
 
-    ih = IntelHex()
-    ih.frombytes(eeprom_data)
-    ih.tofile(file_path, format='hex', byte_count=byte_count)
+def i2c_transfer(messages):
+    # One combined transaction: a repeated START between the messages, one STOP at the end.
+    # messages is a list of (address, flags, bytearray); read messages are filled in place.
+    msgs = (i2c_msg * len(messages))()
+    buffers = []
+    for index, (address, flags, data) in enumerate(messages):
+        buffer = (ctypes.c_uint8 * len(data)).from_buffer(data)
+        buffers.append(buffer)
+        msgs[index] = i2c_msg(address, flags, len(data), buffer)
+    fcntl.ioctl(open_i2c_rdwr(), I2C_RDWR, i2c_rdwr_ioctl_data(msgs, len(messages)))
 
 
+def read_eeprom_block(EEPROM_ADDRESS, start_address, data_size):
+    data = bytearray(data_size)
+    i2c_transfer([(EEPROM_ADDRESS, 0, bytearray([start_address >> 8, start_address & 0xFF])),
+                  (EEPROM_ADDRESS, I2C_M_RD, data)])
+    return data
+
+
+def write_eeprom_page(EEPROM_ADDRESS, start_address, data):
+    # The data must not cross a PAGE_SIZE boundary, the EEPROM would wrap to the page start.
+    i2c_transfer([(EEPROM_ADDRESS, 0, bytearray([start_address >> 8, start_address & 0xFF]) + bytearray(data))])
+
+
+def poll_eeprom_ack(EEPROM_ADDRESS, start_address):
+    # The EEPROM does not acknowledge its address during the write cycle. The
+    # poll sends only the memory address, which starts no write cycle.
+    polls = 0
+    deadline = time.monotonic() + EEPROM_WRITE_TIMEOUT
+    while True:
+        polls += 1
+        try:
+            i2c_transfer([(EEPROM_ADDRESS, 0, bytearray([start_address >> 8, start_address & 0xFF]))])
+            return polls
+        except OSError:
+            if time.monotonic() > deadline:
+                raise
+
 def hex_to_list(hex_filename):
     ih = IntelHex(hex_filename)
     data_list = ih.tobinarray()
     return data_list
 
 
-def dump_firmware_region(EEPROM_ADDRESS, dump_regions, line_length, firmware_dump_file = "firmware_dump.hex"):
-    global bus
+def dump_firmware_region(EEPROM_ADDRESS, dump_regions, line_length, firmware_dump_file = "firmware_dump.hex",
+                         compare_file = None):
+    if compare_file != None:
+        # The file is compared against the first region, or the full EEPROM.
+        region = dump_regions[0] if dump_regions else None
+        start_address, data_size, suffix = DUMP_REGIONS.get(region, (0, EEPROM_DUMP_SIZE, ""))
+        print(f"\nComparing {compare_file} with EEPROM at 0x{start_address:04X} ...")
+        if (compare_hardware(EEPROM_ADDRESS, data_size, start_address, compare_file)):
+            print("EEPROM matches.")
+        return
+
     if dump_regions == None:
-        data_size     = FIRMWARE_1_SIZE + FIRMWARE_2_SIZE + CONFIG_SIZE + UNUSED_SIZE
-        start_address = 0
-        dump_file     = firmware_dump_file
-        print(f"\nDumping Full EEPROM into {dump_file} ...")
-        if (dump_hardware(EEPROM_ADDRESS, data_size, start_address, line_length, dump_file)):
+        print(f"\nDumping Full EEPROM into {firmware_dump_file} ...")
+        if (dump_hardware(EEPROM_ADDRESS, EEPROM_DUMP_SIZE, 0, line_length, firmware_dump_file)):
             print("Dumping Complete.")
-    else:
-        if REGION_OPTN_FIRMWARE_1 in dump_regions:
-            data_size     = FIRMWARE_1_SIZE
-            start_address = 0
-            dump_file     = firmware_dump_file.replace(".hex", "_fw_1.hex")
-            print(f"\nDumping EEPROM Firmware 1 Region into {dump_file} ...")
+        return
+
+    for region in [REGION_OPTN_FIRMWARE_1, REGION_OPTN_FIRMWARE_2, REGION_OPTN_CONFIG, REGION_OPTN_UNUSED]:
+        if region in dump_regions:
+            start_address, data_size, suffix = DUMP_REGIONS[region]
+            root, extension = os.path.splitext(firmware_dump_file)
+            dump_file = root + suffix + extension
+            print(f"\nDumping EEPROM {DUMP_REGION_NAMES[region]} Region into {dump_file} ...")
             if (dump_hardware(EEPROM_ADDRESS, data_size, start_address, line_length, dump_file)):
                 print("Dumping Complete.")
 
-        if REGION_OPTN_FIRMWARE_2 in dump_regions:
-            data_size     = FIRMWARE_2_SIZE
-            start_address = FIRMWARE_1_SIZE
-            dump_file     = firmware_dump_file.replace(".hex", "_fw_2.hex")
-            print(f"\nDumping EEPROM Firmware 2 Region into {dump_file} ...")
-            if (dump_hardware(EEPROM_ADDRESS, data_size, start_address, line_length, dump_file)):
-                print("Dumping Complete.")
 
-        if REGION_OPTN_CONFIG in dump_regions:
-            data_size     = CONFIG_SIZE
-            start_address = FIRMWARE_1_SIZE + FIRMWARE_2_SIZE
-            dump_file     = firmware_dump_file.replace(".hex", "_conf.hex")
-            print(f"\nDumping EEPROM Config Region into {dump_file} ...")
-            if (dump_hardware(EEPROM_ADDRESS, data_size, start_address, line_length, dump_file)):
-                print("Dumping Complete.")
+def read_eeprom_blocks(EEPROM_ADDRESS, start_address, data_size):
+    # Sequential reads of DUMP_BLOCK_SIZE bytes, each at a page boundary, yielded with their offset.
+    offset = 0
+    while offset < data_size:
+        length = min(DUMP_BLOCK_SIZE, data_size - offset)
+        yield offset, read_eeprom_block(EEPROM_ADDRESS, start_address + offset, length)
+        offset += length
+        print(f"Progress : [{offset // PAGE_SIZE}/{(data_size + PAGE_SIZE - 1) // PAGE_SIZE} pages]  "
+              f"{offset * 100 / data_size:.2f}%", end="\r")
+    print("\n")
 
-        if REGION_OPTN_UNUSED in dump_regions:
-            data_size     = UNUSED_SIZE
-            start_address = FIRMWARE_1_SIZE + FIRMWARE_2_SIZE + CONFIG_SIZE
-            dump_file     = firmware_dump_file.replace(".hex", "_unusd.hex")
-            print(f"\nDumping EEPROM Unused Region into {dump_file} ...")
-            if (dump_hardware(EEPROM_ADDRESS, data_size, start_address, line_length, dump_file)):
-                print("Dumping Complete.")
+
+def write_hex_record(dump_file, record_type, address, data):
+    record = bytes([len(data), (address >> 8) & 0xFF, address & 0xFF, record_type]) + bytes(data)
+    dump_file.write(":" + record.hex().upper() + f"{(-sum(record)) & 0xFF:02X}\n")
 
 
 def dump_hardware(EEPROM_ADDRESS, data_size, start_address, line_length, firmware_dump_file):
+    # Raw binary for a .bin file, Intel HEX otherwise; every block is written out as soon as it is read.
+    if line_length == HALF_LINE:
+        byte_count = 16
+    else:
+        byte_count = 32
+
+    binary = firmware_dump_file.lower().endswith(".bin")
     try:
-        msb_address = start_address >> 8
-        lsb_address = start_address & 0xFF
-        bus.write_i2c_block_data(EEPROM_ADDRESS, msb_address, [lsb_address])
-        time.sleep(0.01)
-        total_size_str = str(data_size)
-        data_buffer = []
-        for index in range(data_size):
-            value = bus.read_byte(EEPROM_ADDRESS)
-            data_buffer.append(value)
-            percent = ((index + 1) * 100)/data_size
-            percent = "{:.2f}".format(round(percent, 2))
-            print(f"Progress : [{index + 1}/{total_size_str}]  {percent}%", end="\r")
-        print("\n")
-
-        dump_eeprom_to_intel_hex(firmware_dump_file, data_buffer, line_length)
+        with open(firmware_dump_file, "wb" if binary else "w") as dump_file:
+            segment = 0
+            for offset, data in read_eeprom_blocks(EEPROM_ADDRESS, start_address, data_size):
+                if binary:
+                    dump_file.write(data)
+                    continue
+                for index in range(0, len(data), byte_count):
+                    address = offset + index
+                    if address >> 16 != segment:
+                        segment = address >> 16
+                        write_hex_record(dump_file, 0x04, 0, [segment >> 8, segment & 0xFF])
+                    write_hex_record(dump_file, 0x00, address, data[index:index + byte_count])
+            if not binary:
+                write_hex_record(dump_file, 0x01, 0, [])
         return True
     except Exception as e:
         print("Error: ", e)
         return False
 
 
-def update_eeprom(data_list, EEPROM_ADDRESS, start_address = 0, legacy_upload = False):
+def compare_hardware(EEPROM_ADDRESS, data_size, start_address, compare_file):
+    # Addresses of the hex file are offsets in the region, gaps and the last page are blank.
+    try:
+        expected = pad_to_page(IntelHex(compare_file).tobinarray(start = 0))
+        if len(expected) > data_size:
+            print(f"ERROR: {compare_file} is larger than the region!!!")
+            return False
+
+        for offset, data in read_eeprom_blocks(EEPROM_ADDRESS, start_address, len(expected)):
+            for page in range(0, len(data), PAGE_SIZE):
+                wanted = expected[offset + page:offset + page + PAGE_SIZE]
+                actual = list(data[page:page + PAGE_SIZE])
+                if actual != wanted:
+                    index = next(index for index in range(PAGE_SIZE) if actual[index] != wanted[index])
+                    address = start_address + offset + page + index
+                    print(f"Mismatch in page {(offset + page) // PAGE_SIZE} at 0x{address:04X}: "
+                          f"EEPROM 0x{actual[index]:02X}, file 0x{wanted[index]:02X}")
+                    return False
+        return True
+    except Exception as e:
+        print("Error: ", e)
+        return False
+
+
+def update_eeprom_pages(data_list, EEPROM_ADDRESS, start_address = 0):
+    # Whole EEPROM pages in one transfer each, pages which already hold the data are read back and skipped.
+    total_size = len(data_list)
+    written_pages = 0
+    skipped_pages = 0
+    polls_max = 0
+    index = 0
+    while index < total_size:
+        address = start_address + index
+        length = min(PAGE_SIZE - address % PAGE_SIZE, total_size - index)
+        data = bytearray(data_list[index:index + length])
+        if read_eeprom_block(EEPROM_ADDRESS, address, length) == data:
+            skipped_pages += 1
+        else:
+            write_eeprom_page(EEPROM_ADDRESS, address, data)
+            polls_max = max(polls_max, poll_eeprom_ack(EEPROM_ADDRESS, address))
+            written_pages += 1
+        index += length
+        percent = "{:.2f}".format(round(index * 100 / total_size, 2))
+        print(f"Progress : [{index}/{total_size}]  {percent}%", end="\r")
+
+    print("\n")
+    print(f"Pages written: {written_pages}, unchanged pages skipped: {skipped_pages}, "
+          f"write cycle polls (max): {polls_max}")
+
+
+def update_eeprom(data_list, EEPROM_ADDRESS, start_address = 0, legacy_upload = False, page_write = False):
     global bus
+    if page_write:
+        update_eeprom_pages(data_list, EEPROM_ADDRESS, start_address)
+        return
     total_size = len(data_list)
     total_size_str = str(total_size)
     frame_index = 0
@@ -189,9 +359,10 @@ def update_eeprom(data_list, EEPROM_ADDRESS, start_address = 0, legacy_upload =
                 payload = []
             payload.append(byte_data)
             frame_index += 1
-            if frame_index != PAYLOAD_SIZE:
+            # Packed images and patches do not end on a payload boundary, the last payload is shorter
+            if frame_index != PAYLOAD_SIZE and index + 1 != total_size:
                 continue
-            address = start_address + index - (PAYLOAD_SIZE - 1)
+            address = start_address + index - (frame_index - 1)
         else:
             payload = [byte_data]
             address = start_address + index
@@ -209,27 +380,242 @@ def update_eeprom(data_list, EEPROM_ADDRESS, start_address = 0, legacy_upload =
     print("\n")
 
 
-def write_firmware(firmware_file, slot, EEPROM_ADDRESS, legacy_write):
-    firmware_data = hex_to_list(firmware_file)
+def pad_to_page(data_list):
+    data_list = list(data_list)
+    if len(data_list) % PAGE_SIZE:
+        data_list.extend([FORMAT_BYTE] * (PAGE_SIZE - len(data_list) % PAGE_SIZE))
+    return data_list
+
+
+def image_header_address(slot):
+    return CONFIG_START_ADDRESS + int(slot) * PAGE_SIZE
+
+
+def build_image_header(firmware_data, stored_data, version, flags = 0, base_checksum = 0):
+    version_fields = [int(field) for field in version.split(".")]
+    version_fields.extend([0] * (4 - len(version_fields)))
+    major, minor, patch, build = version_fields[:4]
+    checksum = zlib.crc32(bytes(stored_data)) & 0xFFFFFFFF
+    return list(struct.pack(IMAGE_HEADER_FORMAT, IMAGE_HEADER_MAGIC, len(firmware_data), checksum,
+                            major & 0xFF, minor & 0xFF, patch & 0xFF, flags, build & 0xFFFF, len(stored_data),
+                            base_checksum))
+
+
+def pad_to_slot(data_list):
+    return list(data_list) + [FORMAT_BYTE] * (FIRMWARE_1_SIZE - len(data_list))
+
+
+def build_delta(base_data, firmware_data):
+    # Patch as applied by patch_image_in_flash() in src/iBootLoader.ino: a page
+    # number, then (keep, literal) count pairs with the literal bytes, per changed page.
+    base = pad_to_slot(base_data)
+    new = pad_to_slot(firmware_data)
+    delta = []
+    for page in range(FIRMWARE_1_SIZE // PAGE_SIZE):
+        start = page * PAGE_SIZE
+        old_page = base[start:start + PAGE_SIZE]
+        new_page = new[start:start + PAGE_SIZE]
+        if old_page == new_page:
+            continue
+        delta.append(page)
+        offset = 0
+        while offset < PAGE_SIZE:
+            keep = 0
+            while offset + keep < PAGE_SIZE and old_page[offset + keep] == new_page[offset + keep]:
+                keep += 1
+            literal_start = offset + keep
+            literal_end = literal_start
+            while literal_end < PAGE_SIZE:
+                run = 0
+                while literal_end + run < PAGE_SIZE and old_page[literal_end + run] == new_page[literal_end + run]:
+                    run += 1
+                # Short equal runs are cheaper as literals than as a new op pair
+                if run >= DELTA_MIN_KEEP or literal_end + run == PAGE_SIZE:
+                    break
+                literal_end += run + 1
+            delta.extend([keep, literal_end - literal_start])
+            delta.extend(new_page[literal_start:literal_end])
+            offset = literal_end
+    delta.append(DELTA_END_PAGE)
+    return delta, zlib.crc32(bytes(base)) & 0xFFFFFFFF
+
+
+def pack_image(data_list):
+    # LZSS as decoded by src/lz_lite.cpp: a flag byte (LSB first, 1 = literal)
+    # before every 8 items, back references are 12 bit distance and 4 bit length.
+    data = bytes(data_list)
+    size = len(data)
+    packed = bytearray()
+    chains = {}
+    position = 0
+
+    while position < size:
+        flag_index = len(packed)
+        packed.append(0)
+        flags = 0
+        for bit in range(8):
+            if position >= size:
+                break
+            best_length = 0
+            best_distance = 0
+            max_length = min(LZ_MAX_MATCH, size - position)
+            if max_length >= LZ_MIN_MATCH:
+                for candidate in reversed(chains.get(data[position:position + LZ_MIN_MATCH], [])[-LZ_MAX_CANDIDATES:]):
+                    distance = position - candidate
+                    if distance > LZ_WINDOW_SIZE:
+                        break
+                    length = 0
+                    while length < max_length and data[candidate + length] == data[position + length]:
+                        length += 1
+                    if length > best_length:
+                        best_length = length
+                        best_distance = distance
+                        if length == max_length:
+                            break
+
+            if best_length >= LZ_MIN_MATCH:
+                packed.append((best_distance - 1) & 0xFF)
+                packed.append((((best_distance - 1) >> 8) << 4) | (best_length - LZ_MIN_MATCH))
+                step = best_length
+            else:
+                flags |= 1 << bit
+                packed.append(data[position])
+                step = 1
+
+            for index in range(position, position + step):
+                chains.setdefault(data[index:index + LZ_MIN_MATCH], []).append(index)
+            position += step
+        packed[flag_index] = flags
+
+    return list(packed)
+
+
+def print_transfer_estimate(label, size):
+    # 9 clocks per byte on the bus; host uploads one PAYLOAD_SIZE block per 5 ms write cycle,
+    # or with page writes one page per write cycle plus its read back at 100 kHz
+    upload_seconds = (size + PAYLOAD_SIZE - 1) // PAYLOAD_SIZE * 0.005
+    page_seconds = (size + PAGE_SIZE - 1) // PAGE_SIZE * 0.005 + size * 2 * 9 / 100000
+    print(f"{label:<12}: {size:6d} bytes, boot read {size * 9 / 100000:.3f} s @100kHz, "
+          f"{size * 9 / 400000:.3f} s @400kHz, upload ~{upload_seconds:.2f} s, page write ~{page_seconds:.2f} s")
+
+
+def write_image_header(header, slot, EEPROM_ADDRESS, page_write = False):
+    address = image_header_address(slot)
+    if page_write:
+        write_eeprom_page(EEPROM_ADDRESS, address, header)
+        poll_eeprom_ack(EEPROM_ADDRESS, address)
+        return
+    # One PAYLOAD_SIZE block per write cycle, a header with its occupancy map exceeds one SMBus block.
+    for index in range(0, len(header), PAYLOAD_SIZE):
+        msb_address = (address + index) >> 8
+        lsb_address = (address + index) & 0xFF
+        payload_with_lsb_address = [lsb_address]
+        payload_with_lsb_address.extend(header[index:index + PAYLOAD_SIZE])
+        bus.write_i2c_block_data(EEPROM_ADDRESS, msb_address, payload_with_lsb_address)
+        time.sleep(0.005)
+
+
+def build_occupancy_map(firmware_data):
+    # One bit per page as read by read_occupancy_map() in src/iBootLoader.ino, set for pages which hold data.
+    page_count = len(firmware_data) // PAGE_SIZE
+    occupancy_map = [0] * ((page_count + 7) // 8)
+    for page in range(page_count):
+        if any(byte != FORMAT_BYTE for byte in firmware_data[page * PAGE_SIZE:(page + 1) * PAGE_SIZE]):
+            occupancy_map[page // 8] |= 1 << (page % 8)
+    return occupancy_map
+
+
+def occupied_runs(occupancy_map, page_count):
+    # (first page, page count) of every run of pages set in the map.
+    runs = []
+    for page in range(page_count):
+        if not occupancy_map[page // 8] & (1 << (page % 8)):
+            continue
+        if runs and runs[-1][0] + runs[-1][1] == page:
+            runs[-1][1] += 1
+        else:
+            runs.append([page, 1])
+    return runs
+
+
+def write_firmware(firmware_file, slot, EEPROM_ADDRESS, legacy_write, version = "0.0.0.0", compress = False,
+                   base_file = None, page_write = False, occupancy = False):
+    firmware_data = pad_to_page(hex_to_list(firmware_file))
+    if len(firmware_data) > FIRMWARE_1_SIZE:
+        print(f"ERROR: Firmware {firmware_file} is larger than a slot!!!")
+        return
+    stored_data = firmware_data
+    flags = 0
+    base_checksum = 0
+    if base_file:
+        delta_data, delta_base_checksum = build_delta(pad_to_page(hex_to_list(base_file)), firmware_data)
+        print_transfer_estimate("Raw image", len(firmware_data))
+        print_transfer_estimate("Patch", len(delta_data))
+        if len(delta_data) < len(firmware_data):
+            print("Storing patch, the bootloader needs delta_enable.")
+            stored_data = delta_data
+            flags = IMAGE_FLAG_DELTA
+            base_checksum = delta_base_checksum
+        else:
+            print("Patch does not save space, storing raw image.")
+    elif compress:
+        packed_data = pack_image(firmware_data)
+        print_transfer_estimate("Raw image", len(firmware_data))
+        print_transfer_estimate("Packed image", len(packed_data))
+        if len(packed_data) < len(firmware_data):
+            print("Storing packed image, the bootloader needs compression_enable.")
+            stored_data = packed_data
+            flags = IMAGE_FLAG_COMPRESSED
+            # The bootloader checks the decoded image in the flash against this CRC
+            base_checksum = zlib.crc32(bytes(firmware_data)) & 0xFFFFFFFF
+        else:
+            print("Packing does not save space, storing raw image.")
+    occupancy_map = None
+    if occupancy and flags:
+        print("Occupancy map is kept for raw images only, storing all pages.")
+    elif occupancy:
+        occupancy_map = build_occupancy_map(firmware_data)
+        flags = IMAGE_FLAG_OCCUPANCY
+        print("Leaving blank pages out, the bootloader needs occupancy_map_enable.")
+    if read_mirror_slot(EEPROM_ADDRESS) == int(slot):
+        # The bootloader would skip the backup into a slot which no longer holds the running firmware.
+        print(f"Slot {slot} mirrors the running firmware, clearing the mirror ...")
+        write_config_record(CONFIG_FWU_MIRROR_ADDRESS, FORMAT_BYTE, EEPROM_ADDRESS)
     print(f"Writting {firmware_file} in slot {slot} ...")
     if slot == FWU_SLOT_1:
         start_address = 0
     if slot == FWU_SLOT_2:
         start_address = FIRMWARE_1_SIZE
     try:
-        update_eeprom(firmware_data, EEPROM_ADDRESS, start_address, legacy_write)
+        header = build_image_header(firmware_data, stored_data, version, flags, base_checksum)
+        # A write cut short must not leave the old header describing the half written slot.
+        write_image_header([0x00] * 2, slot, EEPROM_ADDRESS, page_write)
+        if occupancy_map is None:
+            update_eeprom(stored_data, EEPROM_ADDRESS, start_address, legacy_write, page_write)
+        else:
+            runs = occupied_runs(occupancy_map, len(firmware_data) // PAGE_SIZE)
+            for first_page, page_count in runs:
+                update_eeprom(stored_data[first_page * PAGE_SIZE:(first_page + page_count) * PAGE_SIZE],
+                              EEPROM_ADDRESS, start_address + first_page * PAGE_SIZE, legacy_write, page_write)
+            print(f"Blank pages left out: {len(firmware_data) // PAGE_SIZE - sum(run[1] for run in runs)}")
+            header.extend([FORMAT_BYTE] * (IMAGE_OCCUPANCY_OFFSET - len(header)))
+            header.extend(occupancy_map)
+        write_image_header(header, slot, EEPROM_ADDRESS, page_write)
+        checksum = zlib.crc32(bytes(stored_data)) & 0xFFFFFFFF
+        print(f"Image: {len(firmware_data)} bytes, {len(firmware_data) // PAGE_SIZE} pages, "
+              f"stored {len(stored_data)} bytes, CRC-32 0x{checksum:08X}")
         print("Writting Complete.")
     except Exception as e:
         print("Error: ", e)
 
 
-def format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write):
+def format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write, page_write = False):
     if format_regions == None:
         over_write_data = [FORMAT_BYTE] * (FIRMWARE_1_SIZE + FIRMWARE_2_SIZE + CONFIG_SIZE + UNUSED_SIZE)
         print("Formating Full EEPROM ...")
         try:
             starting_address = 0
-            update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write)
+            update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write, page_write)
             print("Formating Complete.")
         except Exception as e:
             print("Error: ", e)
@@ -239,7 +625,7 @@ def format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write):
             print("Formating EEPROM Firmware Slot 1 region ...")
             try:
                 starting_address = 0
-                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write)
+                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write, page_write)
             except Exception as e:
                 print("Error: ", e)
                 return
@@ -249,7 +635,7 @@ def format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write):
             print("Formating EEPROM Firmware Slot 2 region ...")
             try:
                 starting_address = FIRMWARE_1_SIZE
-                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write)
+                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write, page_write)
             except Exception as e:
                 print("Error: ", e)
                 return
@@ -259,7 +645,7 @@ def format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write):
             print("Formating EEPROM Config region ...")
             try:
                 starting_address = FIRMWARE_1_SIZE + FIRMWARE_2_SIZE
-                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write)
+                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write, page_write)
             except Exception as e:
                 print("Error: ", e)
                 return
@@ -269,7 +655,7 @@ def format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write):
             print("Formating EEPROM Unused region ...")
             try:
                 starting_address = FIRMWARE_1_SIZE + FIRMWARE_2_SIZE + CONFIG_SIZE
-                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write)
+                update_eeprom(over_write_data, EEPROM_ADDRESS, starting_address, legacy_write, page_write)
             except Exception as e:
                 print("Error: ", e)
                 return
@@ -277,6 +663,100 @@ def format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write):
         print("Formating Complete.")
 
 
+def read_eeprom(EEPROM_ADDRESS, start_address, data_size):
+    return list(read_eeprom_block(EEPROM_ADDRESS, start_address, data_size))
+
+
+def find_config_record(ring_data):
+    # Newest valid record of the ring, as found by find_ring_record() in src/record_ring.cpp.
+    newest = None
+    for index in range(len(ring_data) // CONFIG_RECORD_SIZE):
+        record = bytes(ring_data[index * CONFIG_RECORD_SIZE:(index + 1) * CONFIG_RECORD_SIZE])
+        sequence, data, check = struct.unpack(CONFIG_RECORD_FORMAT, record)
+        if check != zlib.crc32(record[:-1]) & 0xFF:
+            continue
+        if newest is None or 0 < ((sequence - newest[1]) & 0xFFFF) < 0x8000:
+            newest = (index, sequence, list(data))
+    return newest
+
+
+def read_config_data(EEPROM_ADDRESS):
+    # The bootloader reads the fixed page only while the ring is empty, as always without config_ring_enable.
+    newest = find_config_record(read_eeprom(EEPROM_ADDRESS, CONFIG_RING_ADDRESS, CONFIG_RING_SIZE))
+    if newest != None:
+        config_data = list(newest[2])
+    else:
+        config_data = read_eeprom(EEPROM_ADDRESS, CONFIG_START_ADDRESS, CONFIG_RECORD_DATA_SIZE)
+    return config_data, newest
+
+
+def read_mirror_slot(EEPROM_ADDRESS):
+    # Slot the flash was last programmed from, recorded by the bootloader with ab_slots_enable.
+    config_data, _ = read_config_data(EEPROM_ADDRESS)
+    return config_data[CONFIG_FWU_MIRROR_ADDRESS - CONFIG_START_ADDRESS]
+
+
+def resolve_slot(slot, EEPROM_ADDRESS):
+    if slot != FWU_SLOT_OTHER:
+        return slot
+    slot = FWU_SLOT_1 if read_mirror_slot(EEPROM_ADDRESS) == 2 else FWU_SLOT_2
+    print(f"Slot {slot} does not mirror the running firmware.")
+    return slot
+
+
+def write_config_record(address, byte_data, EEPROM_ADDRESS):
+    config_data, newest = read_config_data(EEPROM_ADDRESS)
+    config_data[address - CONFIG_START_ADDRESS] = byte_data
+
+    if newest == None:
+        # Empty ring: the fixed page, moved into the ring by a bootloader with config_ring_enable.
+        bus.write_i2c_block_data(EEPROM_ADDRESS, CONFIG_START_ADDRESS >> 8,
+                                 [CONFIG_START_ADDRESS & 0xFF] + config_data)
+        time.sleep(0.005)
+        return
+
+    index = (newest[0] + 1) % (CONFIG_RING_SIZE // CONFIG_RECORD_SIZE)
+    sequence = (newest[1] + 1) & 0xFFFF
+    record = struct.pack("<H5s", sequence, bytes(config_data))
+    record += bytes([zlib.crc32(record) & 0xFF])
+
+    record_address = CONFIG_RING_ADDRESS + index * CONFIG_RECORD_SIZE
+    bus.write_i2c_block_data(EEPROM_ADDRESS, record_address >> 8, [record_address & 0xFF] + list(record))
+    time.sleep(0.005)
+
+
+def read_boot_timing(EEPROM_ADDRESS):
+    # Timing records of the last boots, written by src/boot_timing.cpp when boot timing is enabled.
+    ring_data = read_eeprom(EEPROM_ADDRESS, BOOT_TIMING_ADDRESS, BOOT_TIMING_SIZE)
+    records = []
+    for index in range(BOOT_TIMING_SIZE // BOOT_TIMING_RECORD_SIZE):
+        record = bytes(ring_data[index * BOOT_TIMING_RECORD_SIZE:(index + 1) * BOOT_TIMING_RECORD_SIZE])
+        fields = struct.unpack(BOOT_TIMING_FORMAT, record)
+        if fields[-1] != zlib.crc32(record[:-1]) & 0xFF:
+            continue
+        records.append(fields)
+
+    if len(records) == 0:
+        print("No boot timing record found.")
+        return
+
+    newest = records[0][0]
+    for record in records:
+        if 0 < ((record[0] - newest) & 0xFFFF) < 0x8000:
+            newest = record[0]
+    records.sort(key = lambda record: (record[0] - newest - 1) & 0xFFFF)
+
+    print(f"{'boot':>6} {'reset':<18}" + "".join(f"{phase:>10}" for phase in BOOT_TIMING_PHASES) + f"{'total':>10}")
+    for record in records:
+        sequence, ticks, reset_flags = record[0], record[1:7], record[7]
+        reset = ",".join(name for flag, name in RESET_FLAGS if reset_flags & flag) or "-"
+        columns = "".join(f"{'>4194':>10}" if tick == BOOT_TIMING_OVERFLOW else f"{tick * BOOT_TIMING_TICK_MS:10.2f}"
+                          for tick in ticks)
+        total = ("> " if BOOT_TIMING_OVERFLOW in ticks else "") + f"{sum(ticks) * BOOT_TIMING_TICK_MS:.2f}"
+        print(f"{sequence:>6} {reset:<18}{columns}{total:>10}")
+    print("Times in ms.")
+
+
 def update_config(config_option, value, EEPROM_ADDRESS):
     address   = None
     byte_data = None
@@ -318,10 +798,7 @@ def update_config(config_option, value, EEPROM_ADDRESS):
     if address != None or byte_data != None:
         print("Updating Config ...")
         try:
-            msb_address = address >> 8
-            lsb_address = address & 0xFF
-            bus.write_i2c_block_data(EEPROM_ADDRESS, msb_address, [lsb_address, byte_data])
-            time.sleep(0.005)
+            write_config_record(address, byte_data, EEPROM_ADDRESS)
             print("Updating Complete.")
         except Exception as e:
             print("Error: ", e)
@@ -329,12 +806,16 @@ def update_config(config_option, value, EEPROM_ADDRESS):
 
 
 def main():
+    global bus
+    import smbus
+
     parser = argparse.ArgumentParser(description = 'Remote Firmware Update')
 
     parser.add_argument(
         "Mode",
-        choices = [OPTION_FORMAT, OPTION_FIRMWARE, OPTION_CONFIG, OPTION_DUMP],
-        help    = f"Use '{OPTION_FORMAT}' or '{OPTION_FIRMWARE}' or '{OPTION_CONFIG}' or '{OPTION_DUMP}' for select the mode"
+        choices = [OPTION_FORMAT, OPTION_FIRMWARE, OPTION_CONFIG, OPTION_DUMP, OPTION_TIMING],
+        help    = f"Use '{OPTION_FORMAT}' or '{OPTION_FIRMWARE}' or '{OPTION_CONFIG}' or '{OPTION_DUMP}' or "
+                  f"'{OPTION_TIMING}' for select the mode"
     )
 
     parser.add_argument(
@@ -357,9 +838,9 @@ def main():
         parser.add_argument(
             arg_opt["slot"][ARG_SHORT],
             arg_opt["slot"][ARG_FULL],
-            choices = [FWU_SLOT_1, FWU_SLOT_2],
+            choices = [FWU_SLOT_1, FWU_SLOT_2, FWU_SLOT_OTHER],
             default = FWU_SLOT_1,
-            help    = "Firmware slot"
+            help    = "Firmware slot; A is the slot not mirroring the running firmware"
         )
 
         parser.add_argument(
@@ -369,13 +850,53 @@ def main():
             help   = "Byte by Byte write. Slow but steady process."
         )
 
+        parser.add_argument(
+            arg_opt["page"][ARG_SHORT],
+            arg_opt["page"][ARG_FULL],
+            action ='store_true',
+            help   = "Page by Page write through i2c-dev, unchanged pages are skipped."
+        )
+
+        parser.add_argument(
+            arg_opt["version"][ARG_SHORT],
+            arg_opt["version"][ARG_FULL],
+            default = "0.0.0.0",
+            help    = "Firmware version stored in the image header. (Default 0.0.0.0)"
+        )
+
+        parser.add_argument(
+            arg_opt["compress"][ARG_SHORT],
+            arg_opt["compress"][ARG_FULL],
+            action ='store_true',
+            help   = "Store the image packed, the bootloader unpacks it while flashing."
+        )
+
+        parser.add_argument(
+            arg_opt["base"][ARG_SHORT],
+            arg_opt["base"][ARG_FULL],
+            help   = "Hex file of the running firmware; store a patch against it instead of the image."
+        )
+
+        parser.add_argument(
+            arg_opt["occupancy"][ARG_SHORT],
+            arg_opt["occupancy"][ARG_FULL],
+            action ='store_true',
+            help   = "Leave blank pages out of the slot and store an occupancy map with the header."
+        )
+
     # Firmware Dumping Options
     if OPTION_DUMP in sys.argv:
         parser.add_argument(
             arg_opt["dump_file"][ARG_SHORT],
             arg_opt["dump_file"][ARG_FULL],
             default = "firmware_dump.hex",
-            help    = "Dump file name"
+            help    = "Dump file name, raw binary for a .bin file, Intel HEX otherwise"
+        )
+
+        parser.add_argument(
+            arg_opt["compare"][ARG_SHORT],
+            arg_opt["compare"][ARG_FULL],
+            help    = "Hex file to compare with the first region instead of dumping; stops at the first differing page"
         )
 
         parser.add_argument(
@@ -413,9 +934,9 @@ def main():
         parser.add_argument(
             arg_opt["slot"][ARG_SHORT],
             arg_opt["slot"][ARG_FULL],
-            choices = [FWU_SLOT_1, FWU_SLOT_2],
+            choices = [FWU_SLOT_1, FWU_SLOT_2, FWU_SLOT_OTHER],
             default = FWU_SLOT_1,
-            help    = "Firmware slot"
+            help    = "Firmware slot; A is the slot not mirroring the running firmware"
         )
 
         parser.add_argument(
@@ -443,7 +964,15 @@ def main():
             help   = "Byte by Byte write. Slow but steady process."
         )
 
+        parser.add_argument(
+            arg_opt["page"][ARG_SHORT],
+            arg_opt["page"][ARG_FULL],
+            action ='store_true',
+            help   = "Page by Page write through i2c-dev, unchanged pages are skipped."
+        )
+
     args = parser.parse_args()
+    bus = smbus.SMBus(1)
 
     start_time = time.time()
 
@@ -452,11 +981,19 @@ def main():
 
     if OPTION_FIRMWARE in sys.argv:
         firmware_file = args.firmware
-        firmware_slot = args.slot
+        firmware_slot = resolve_slot(args.slot, EEPROM_ADDRESS)
         legacy_write   = args.legacy
-
-        if os.path.exists(firmware_file):
-            write_firmware(firmware_file, firmware_slot, EEPROM_ADDRESS, legacy_write)
+        fw_version     = args.fw_version
+        compress       = args.compress
+        base_file      = args.base
+        page_write     = args.page_write
+        occupancy      = args.occupancy
+
+        if base_file and not os.path.exists(base_file):
+            print(f"ERROR: Base firmware file {base_file} Not Found!!!")
+        elif os.path.exists(firmware_file):
+            write_firmware(firmware_file, firmware_slot, EEPROM_ADDRESS, legacy_write, fw_version, compress,
+                           base_file, page_write, occupancy)
         else:
             print(f"ERROR: Firmware file {firmware_file} Not Found!!!")
 
@@ -464,20 +1001,29 @@ def main():
     if OPTION_FORMAT in sys.argv:
         format_regions = args.region
         legacy_write   = args.legacy
-        format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write)
+        page_write     = args.page_write
+        format_eeprom(format_regions, EEPROM_ADDRESS, legacy_write, page_write)
 
 
     if OPTION_DUMP in sys.argv:
         dump_file    = args.dump_file
         dump_regions = args.region
         line_length  = args.length
-        dump_firmware_region(EEPROM_ADDRESS, dump_regions, line_length, dump_file)
+        compare_file = args.compare
+        dump_firmware_region(EEPROM_ADDRESS, dump_regions, line_length, dump_file, compare_file)
+
+
+    if OPTION_TIMING in sys.argv:
+        try:
+            read_boot_timing(EEPROM_ADDRESS)
+        except Exception as e:
+            print("Error: ", e)
 
 
     if OPTION_CONFIG in sys.argv:
         default  = args.default
         fwm_mode = args.fwm_mode
-        fwm_slot = args.slot
+        fwm_slot = resolve_slot(args.slot, EEPROM_ADDRESS)
         fwm_bkup = args.backup
         if default:
             print("\nApplying Default Config values.")
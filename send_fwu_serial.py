@@ -0,0 +1,162 @@
+# iAloy Module Firmware - send_fwu_serial.py
+#
+#  MIT License
+#
+#  @copyright
+#  Copyright (c) 2020-2024 iAloy
+#
+#  Permission is hereby granted, free of charge, to any person obtaining a copy
+#  of this software and associated documentation files (the "Software"), to deal
+#  in the Software without restriction, including without limitation the rights
+#  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+#  copies of the Software, and to permit persons to whom the Software is
+#  furnished to do so, subject to the following conditions:
+#
+#  The above copyright notice and this permission notice shall be included in all
+#  copies or substantial portions of the Software.
+#
+#  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+#  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+#  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+#  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+#  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+#  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+#  SOFTWARE.
+
+
+
+import time
+import argparse
+import os
+import struct
+import zlib
+import serial
+
+from manage_fwu_eeprom import (PAGE_SIZE, FIRMWARE_1_SIZE, IMAGE_FLAG_COMPRESSED, IMAGE_FLAG_DELTA, hex_to_list,
+                               pad_to_page, build_image_header, build_delta, pack_image)
+
+# Frame layout and answers as in src/serial_ingest.h
+INGEST_BAUD             = 500000
+INGEST_SYNC             = 0x7E
+INGEST_ACK              = 0x06
+INGEST_NAK              = 0x15
+INGEST_FRAME_HELLO      = ord('H')
+INGEST_FRAME_PAGE       = ord('P')
+INGEST_FRAME_END        = ord('E')
+INGEST_REPLY_SIZE       = 3
+
+HELLO_PERIOD            = 0.002 # The bootloader listens 25 ms after reset.
+HELLO_TIMEOUT           = 3.0
+REPLY_TIMEOUT           = 0.1
+FRAME_RETRIES           = 8
+
+
+def build_frame(frame_type, page = 0, payload = []):
+    body = bytes([frame_type, page, len(payload)]) + bytes(payload)
+    return bytes([INGEST_SYNC]) + body + struct.pack("<I", zlib.crc32(body) & 0xFFFFFFFF)
+
+
+def read_reply(port, timeout):
+    # Skip the boot banner and anything else that is not an answer.
+    deadline = time.time() + timeout
+    reply = b""
+    while time.time() < deadline:
+        reply += port.read(1)
+        if reply and reply[0] not in (INGEST_ACK, INGEST_NAK):
+            reply = b""
+        if len(reply) == INGEST_REPLY_SIZE:
+            return reply
+    return None
+
+
+def open_session(port):
+    # Opening the port resets the board through DTR; send hellos until the bootloader answers.
+    hello = build_frame(INGEST_FRAME_HELLO)
+    deadline = time.time() + HELLO_TIMEOUT
+    port.reset_input_buffer()
+    while time.time() < deadline:
+        port.write(hello)
+        reply = read_reply(port, HELLO_PERIOD)
+        if reply and reply[0] == INGEST_ACK and reply[1] == INGEST_FRAME_HELLO:
+            return True
+    return False
+
+
+def send_frame(port, frame_type, page, payload):
+    frame = build_frame(frame_type, page, payload)
+    for _ in range(FRAME_RETRIES):
+        port.write(frame)
+        reply = read_reply(port, REPLY_TIMEOUT)
+        # An answer to an earlier frame is stale, send again.
+        if reply and reply[0] == INGEST_ACK and reply[1] == frame_type and reply[2] == page:
+            return True
+    return False
+
+
+def send_firmware(port_name, firmware_file, version, compress, base_file):
+    firmware_data = pad_to_page(hex_to_list(firmware_file))
+    if len(firmware_data) > FIRMWARE_1_SIZE:
+        print(f"ERROR: Firmware {firmware_file} is larger than a slot!!!")
+        return False
+    stored_data = firmware_data
+    flags = 0
+    base_checksum = 0
+    if base_file:
+        delta_data, delta_base_checksum = build_delta(pad_to_page(hex_to_list(base_file)), firmware_data)
+        if len(delta_data) < len(firmware_data):
+            print("Sending patch, the bootloader needs delta_enable.")
+            stored_data = delta_data
+            flags = IMAGE_FLAG_DELTA
+            base_checksum = delta_base_checksum
+    elif compress:
+        packed_data = pack_image(firmware_data)
+        if len(packed_data) < len(firmware_data):
+            print("Sending packed image, the bootloader needs compression_enable.")
+            stored_data = packed_data
+            flags = IMAGE_FLAG_COMPRESSED
+    header = build_image_header(firmware_data, stored_data, version, flags, base_checksum)
+    pages = pad_to_page(stored_data)
+
+    with serial.Serial(port_name, INGEST_BAUD, timeout = HELLO_PERIOD) as port:
+        if not open_session(port):
+            print("ERROR: Bootloader did not answer, is serial_ingest_enable set?")
+            return False
+        print(f"Sending {firmware_file}: {len(pages) // PAGE_SIZE} pages ...")
+        for page in range(len(pages) // PAGE_SIZE):
+            if not send_frame(port, INGEST_FRAME_PAGE, page, pages[page * PAGE_SIZE:(page + 1) * PAGE_SIZE]):
+                print(f"ERROR: Page {page} was not acknowledged!!!")
+                return False
+        if not send_frame(port, INGEST_FRAME_END, 0, header):
+            print("ERROR: Image header was not acknowledged!!!")
+            return False
+    print("Sending Complete, the bootloader flashes the image now.")
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description = 'Serial Firmware Upload')
+
+    parser.add_argument("-p", "--port", required = True, help = "Serial port of the board, e.g. /dev/ttyUSB0")
+    parser.add_argument("-f", "--firmware", required = True, help = "Firmware hex file")
+    parser.add_argument("-v", "--fw_version", default = "0.0.0.0",
+                        help = "Firmware version stored in the image header. (Default 0.0.0.0)")
+    parser.add_argument("-c", "--compress", action = 'store_true',
+                        help = "Send the image packed, the bootloader unpacks it while flashing.")
+    parser.add_argument("-B", "--base",
+                        help = "Hex file of the running firmware; send a patch against it instead of the image.")
+
+    args = parser.parse_args()
+
+    start_time = time.time()
+
+    if args.base and not os.path.exists(args.base):
+        print(f"ERROR: Base firmware file {args.base} Not Found!!!")
+    elif os.path.exists(args.firmware):
+        send_firmware(args.port, args.firmware, args.fw_version, args.compress, args.base)
+    else:
+        print(f"ERROR: Firmware file {args.firmware} Not Found!!!")
+
+    print(f"\nExecution time: {time.time() - start_time:.2f} seconds")
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,42 @@
+/**
+  @file
+  iBootLoader - sim/include/avr/boot.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_AVR_BOOT_H
+#define SIM_AVR_BOOT_H
+
+#include <avr/io.h>
+
+#define boot_page_fill(address, data)   sim_boot_page_fill((address), (data))
+#define boot_page_erase(address)        sim_boot_page_erase(address)
+#define boot_page_write(address)        sim_boot_page_write(address)
+#define boot_rww_enable()               sim_boot_rww_enable()
+#define boot_spm_busy()                 sim_boot_spm_busy()
+#define boot_spm_busy_wait()            do {} while (boot_spm_busy())
+
+#endif //SIM_AVR_BOOT_H
@@ -0,0 +1,158 @@
+/**
+  @file
+  iBootLoader - sim/include/avr/io.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_AVR_IO_H
+#define SIM_AVR_IO_H
+
+#include <stdint.h>
+
+#include "sim_mcu.h"
+
+#define _BV(bit)        (1 << (bit))
+
+#define SPM_PAGESIZE    SIM_PAGE_SIZE
+#define FLASHEND        (SIM_FLASH_SIZE - 1)
+#define E2END           (SIM_INTERNAL_EEPROM_SIZE - 1)
+
+#define DDRB            (sim_register(SIM_DDRB))
+#define PORTB           (sim_register(SIM_PORTB))
+#define PINB            (sim_register(SIM_PINB))
+#define DDRD            (sim_register(SIM_DDRD))
+#define PORTD           (sim_register(SIM_PORTD))
+#define PIND            (sim_register(SIM_PIND))
+
+#define TWBR            (sim_register(SIM_TWBR))
+#define TWSR            (sim_register(SIM_TWSR))
+#define TWDR            (sim_register(SIM_TWDR))
+#define TWCR            (sim_register(SIM_TWCR))
+
+#define UCSR0A          (sim_register(SIM_UCSR0A))
+#define UCSR0B          (sim_register(SIM_UCSR0B))
+#define UCSR0C          (sim_register(SIM_UCSR0C))
+#define UBRR0L          (sim_register(SIM_UBRR0L))
+#define UBRR0H          (sim_register(SIM_UBRR0H))
+#define UDR0            (sim_register(SIM_UDR0))
+
+#define WDTCSR          (sim_register(SIM_WDTCSR))
+#define MCUSR           (sim_register(SIM_MCUSR))
+#define SPMCSR          (sim_register(SIM_SPMCSR))
+
+#define TCCR1A          (sim_register(SIM_TCCR1A))
+#define TCCR1B          (sim_register(SIM_TCCR1B))
+#define TCNT1           (sim_register16(SIM_TCNT1L))
+#define TIFR1           (sim_register(SIM_TIFR1))
+
+#define EEAR            (sim_register16(SIM_EEARL))
+#define EEDR            (sim_register(SIM_EEDR))
+#define EECR            (sim_register(SIM_EECR))
+
+#define PINB0   0
+#define PINB1   1
+#define PINB2   2
+#define PINB3   3
+#define PINB4   4
+#define PINB5   5
+#define PINB6   6
+#define PINB7   7
+
+#define PIND0   0
+#define PIND1   1
+#define PIND2   2
+#define PIND3   3
+#define PIND4   4
+#define PIND5   5
+#define PIND6   6
+#define PIND7   7
+
+// TWCR
+#define TWINT   7
+#define TWEA    6
+#define TWSTA   5
+#define TWSTO   4
+#define TWWC    3
+#define TWEN    2
+#define TWIE    0
+
+// TWSR
+#define TWPS1   1
+#define TWPS0   0
+
+// UCSR0A
+#define RXC0    7
+#define TXC0    6
+#define UDRE0   5
+#define FE0     4
+#define DOR0    3
+#define UPE0    2
+#define U2X0    1
+#define MPCM0   0
+
+// UCSR0B
+#define RXCIE0  7
+#define TXCIE0  6
+#define UDRIE0  5
+#define RXEN0   4
+#define TXEN0   3
+#define UCSZ02  2
+
+// UCSR0C
+#define UCSZ01  2
+#define UCSZ00  1
+
+// WDTCSR
+#define WDIF    7
+#define WDIE    6
+#define WDP3    5
+#define WDCE    4
+#define WDE     3
+#define WDP2    2
+#define WDP1    1
+#define WDP0    0
+
+// TCCR1B
+#define CS12    2
+#define CS11    1
+#define CS10    0
+
+// TIFR1
+#define TOV1    0
+
+// EECR
+#define EERIE   3
+#define EEMPE   2
+#define EEPE    1
+#define EERE    0
+
+// MCUSR
+#define WDRF    3
+#define BORF    2
+#define EXTRF   1
+#define PORF    0
+
+#endif //SIM_AVR_IO_H
@@ -0,0 +1,82 @@
+/**
+  @file
+  iBootLoader - sim/include/avr/pgmspace.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_AVR_PGMSPACE_H
+#define SIM_AVR_PGMSPACE_H
+
+#include <string.h>
+#include <avr/io.h>
+
+#define PROGMEM
+
+/*
+The bootloader reads the flash through integer addresses and its own
+constant tables through pointers. On the host the tables stay in RAM.
+*/
+
+inline uint8_t pgm_read_byte(uint32_t address)
+{
+    return sim_flash_read(address);
+}
+
+inline uint8_t pgm_read_byte(const void *pointer)
+{
+    sim_advance(SIM_FLASH_READ_CYCLES);
+    return *(const uint8_t *)pointer;
+}
+
+inline uint16_t pgm_read_word(const void *pointer)
+{
+    uint16_t value;
+
+    sim_advance(2 * SIM_FLASH_READ_CYCLES);
+    memcpy(&value, pointer, sizeof(value));
+    return value;
+}
+
+// A flash pointer is a word on the target; the host reads a whole pointer at the cost of a word.
+inline void *pgm_read_ptr(const void *pointer)
+{
+    void *value;
+
+    sim_advance(2 * SIM_FLASH_READ_CYCLES);
+    memcpy(&value, pointer, sizeof(value));
+    return value;
+}
+
+inline uint32_t pgm_read_dword(const void *pointer)
+{
+    uint32_t value;
+
+    sim_advance(4 * SIM_FLASH_READ_CYCLES);
+    memcpy(&value, pointer, sizeof(value));
+    return value;
+}
+
+#endif //SIM_AVR_PGMSPACE_H
@@ -0,0 +1,190 @@
+/**
+  @file
+  iBootLoader - sim/sim_bench.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_mcu.h"
+#include "sim_image.h"
+#include "sim_scenario.h"
+#include "ialoy_code.h"
+
+
+typedef struct
+{
+    const char *name;
+    uint8_t     backup;
+    bool        update;
+    bool        update_confirms;
+    uint8_t     mirror_slot;
+    uint8_t     changed_pages;
+    bool        blank_gap;
+    bool        fast_boot_hint;
+} bench_path_t;
+
+
+static const bench_path_t bench_paths[] =
+{
+    {"cold boot",              SIM_FWU_DISABLED, false, true,  0, 0, false, false},
+    {"update with backup",     SIM_FWU_ENABLED,  true,  true,  0, 0, false, false},
+    {"update without backup",  SIM_FWU_DISABLED, true,  true,  0, 0, false, false},
+    {"rollback after WDT",     SIM_FWU_ENABLED,  true,  false, 0, 0, false, false},
+#if DIFF_BACKUP_ENABLE
+    {"update, 4 pages changed", SIM_FWU_ENABLED, true,  true,  0, 4, false, false},
+    {"rollback, 4 pages changed", SIM_FWU_ENABLED, true, false, 0, 4, false, false},
+#endif
+#if OCCUPANCY_MAP_ENABLE
+    {"update, half blank, map", SIM_FWU_ENABLED, true,  true,  0, 0, true,  false},
+#endif
+#if FAST_BOOT_ENABLE
+    {"cold boot, fast path",   SIM_FWU_DISABLED, false, true,  0, 0, false, true},
+#endif
+#if AB_SLOTS_ENABLE
+    {"A/B update",             SIM_FWU_ENABLED,  true,  true,  2, 0, false, false},
+#endif
+};
+
+static const uint16_t bench_sizes[] = {4096, 8192, 16384, SIM_SLOT_SIZE};
+
+static const char *phase_names[BOOT_PHASE_COUNT] =
+{
+    "reset", "config", "verify", "backup", "program", "commit", "jump",
+};
+
+static bool csv_output;
+
+
+/**
+  Print one phase of a boot, from its mark to the next mark reached.
+
+  @param[in]        scenario              Scenario of the boot.
+  @param[in]        boot                  Boot number in the scenario.
+  @param[in]        phase                 BOOT_PHASE_* of the phase.
+  @param[in]        start                 Mark of the phase.
+  @param[in]        end                   Next mark reached, or the end of the boot.
+
+**/
+static void print_phase(const sim_scenario_t *scenario, uint8_t boot, uint8_t phase,
+                        const sim_phase_mark_t *start, const sim_phase_mark_t *end)
+{
+    double ms = (end->cycles - start->cycles) / (double)SIM_MS(1);
+    uint32_t i2c_starts = end->stats.i2c_starts - start->stats.i2c_starts;
+    uint32_t i2c_bytes = end->stats.i2c_bytes - start->stats.i2c_bytes;
+    uint32_t eeprom_writes = end->stats.eeprom_page_writes - start->stats.eeprom_page_writes;
+    uint32_t flash_erases = end->stats.flash_erases - start->stats.flash_erases;
+
+    if (csv_output)
+        printf("%s,%u,%u,%s,%.3f,%u,%u,%u,%u\n",
+               scenario->name, scenario->update_length ? scenario->update_length : scenario->running_length,
+               boot, phase_names[phase], ms, i2c_starts, i2c_bytes, eeprom_writes, flash_erases);
+    else
+        printf("    %-8s %9.2f ms  i2c %5u starts %6u bytes  eeprom %3u writes  flash %3u erases\n",
+               phase_names[phase], ms, i2c_starts, i2c_bytes, eeprom_writes, flash_erases);
+}
+
+
+/**
+  Split one boot at the phase marks and print every phase.
+
+  @param[in]        scenario              Scenario of the boot.
+  @param[in]        boot                  Boot number in the scenario.
+  @param[in]        result                Result of sim_boot().
+
+**/
+static void print_boot_phases(const sim_scenario_t *scenario, uint8_t boot, uint8_t result)
+{
+    uint8_t phase;
+    uint8_t next;
+    uint64_t cycles = sim_boot_end.cycles - sim_phase_marks[0].cycles;
+
+    // A fast boot is below a millisecond, it is shown in microseconds.
+    if (!csv_output)
+        printf("  boot %u: %-11s %9.2f %s\n",
+               boot, result == SIM_BOOT_APPLICATION ? "application" : "wdt reset",
+               cycles < SIM_MS(1) ? cycles / (double)SIM_US(1) : cycles / (double)SIM_MS(1),
+               cycles < SIM_MS(1) ? "us" : "ms");
+
+    for(phase = 0; phase < BOOT_PHASE_COUNT; phase++)
+    {
+        if (!sim_phase_marks[phase].reached)
+            continue;
+
+        for(next = phase + 1; next < BOOT_PHASE_COUNT && !sim_phase_marks[next].reached; next++);
+
+        print_phase(scenario, boot, phase, &sim_phase_marks[phase],
+                    next < BOOT_PHASE_COUNT ? &sim_phase_marks[next] : &sim_boot_end);
+    }
+}
+
+
+int main(int argc, char *argv[])
+{
+    sim_scenario_t scenario;
+    bool passed = true;
+
+    if (argc > 1 && strcmp(argv[1], "--csv") == 0)
+    {
+        csv_output = true;
+        printf("path,image_size,boot,phase,ms,i2c_starts,i2c_bytes,eeprom_writes,flash_erases\n");
+    }
+
+    for(size_t path = 0; path < sizeof(bench_paths) / sizeof(bench_paths[0]); path++)
+    {
+        for(size_t size = 0; size < sizeof(bench_sizes) / sizeof(bench_sizes[0]); size++)
+        {
+            const bench_path_t *bench = &bench_paths[path];
+
+            scenario.name = bench->name;
+            scenario.running_length = bench_sizes[size];
+            scenario.update_length = bench->update ? bench_sizes[size] : 0;
+            scenario.backup = bench->backup;
+            scenario.update_confirms = bench->update_confirms;
+            scenario.expect_update = bench->update && bench->update_confirms;
+            scenario.serial_ingest = false;
+            scenario.application_staging = false;
+            scenario.mirror_slot = bench->mirror_slot;
+            scenario.changed_pages = bench->changed_pages;
+            scenario.blank_gap = bench->blank_gap;
+            scenario.fast_boot_hint = bench->fast_boot_hint;
+            scenario.first_reset = SIM_RESET_POWER_ON;
+            scenario.image_format = SIM_IMAGE_RAW;
+            scenario.second_update = false;
+            scenario.power_loss_erases = 0;
+            scenario.slot_2_write = SIM_SLOT_WRITE_NONE;
+
+            if (!csv_output)
+                printf("%s, %u byte image\n", bench->name, bench_sizes[size]);
+
+            if (!sim_run_scenario(&scenario, print_boot_phases))
+                passed = false;
+        }
+    }
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/**
+  @file
+  iBootLoader - sim/sim_eeprom.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <string.h>
+
+#include "sim_mcu.h"
+#include "sim_eeprom.h"
+
+
+uint8_t  sim_eeprom[SIM_EEPROM_SIZE];
+uint64_t sim_eeprom_write_cycle = SIM_MS(5);
+
+static bool     eeprom_selected;
+static bool     eeprom_reading;
+static uint8_t  eeprom_chip;
+static uint32_t eeprom_block;              // Memory offset of the selected chip and block.
+static uint8_t  eeprom_address_bytes;
+static uint16_t eeprom_address;
+static uint64_t eeprom_busy_until[EEPROM_COUNT];
+
+static uint8_t  eeprom_page_buffer[SIM_EEPROM_PAGE_SIZE];
+static bool     eeprom_page_loaded[SIM_EEPROM_PAGE_SIZE];
+static bool     eeprom_page_pending;
+
+
+/**
+  Power on the EEPROMs, all memory bytes are erased to 0xFF.
+
+**/
+void sim_eeprom_init()
+{
+    memset(sim_eeprom, 0xFF, sizeof(sim_eeprom));
+    memset(eeprom_busy_until, 0, sizeof(eeprom_busy_until));
+    sim_eeprom_start();
+}
+
+
+/**
+  START or repeated START seen on the bus. An unfinished page write without
+  its STOP is dropped.
+
+**/
+void sim_eeprom_start()
+{
+    eeprom_selected      = false;
+    eeprom_reading       = false;
+    eeprom_address_bytes = 0;
+    eeprom_page_pending  = false;
+    memset(eeprom_page_loaded, 0, sizeof(eeprom_page_loaded));
+}
+
+
+/**
+  Address byte after a START.
+
+  @param[in]        sla                   7 bit address and R/W bit.
+
+  @retval           true                  Device acknowledged.
+  @retval           false                 No such chip or its write cycle in progress.
+
+**/
+bool sim_eeprom_address(uint8_t sla)
+{
+    uint8_t device = sla >> 1;
+    uint8_t chip   = device & (EEPROM_MAX_COUNT - 1);
+
+    if ((device & ~(EEPROM_MAX_COUNT - 1) & ~EEPROM_BLOCK_SELECT) != SIM_EEPROM_I2C_ADDRESS ||
+        chip >= EEPROM_COUNT || sim_cycles < eeprom_busy_until[chip])
+        return false;
+
+    eeprom_chip     = chip;
+    eeprom_block    = chip * EEPROM_CHIP_SIZE + ((device & EEPROM_BLOCK_SELECT) ? 0x10000 : 0);
+    eeprom_selected = true;
+    eeprom_reading  = sla & 1;
+    return true;
+}
+
+
+/**
+  Data byte written by the master: two memory address bytes, then data for
+  the page buffer.
+
+  @param[in]        data                  Byte on the bus.
+
+  @retval           true                  Device acknowledged.
+
+**/
+bool sim_eeprom_write(uint8_t data)
+{
+    uint16_t page_start;
+
+    if (!eeprom_selected || eeprom_reading)
+        return false;
+
+    if (eeprom_address_bytes < 2)
+    {
+        if (eeprom_address_bytes++ == 0)
+            eeprom_address = data << 8;
+        else
+            eeprom_address |= data;
+        return true;
+    }
+
+    // Data after the end of the page wraps to its start, as on the real part.
+    page_start = eeprom_address & ~(SIM_EEPROM_PAGE_SIZE - 1);
+    eeprom_page_buffer[eeprom_address - page_start] = data;
+    eeprom_page_loaded[eeprom_address - page_start] = true;
+    eeprom_page_pending = true;
+    eeprom_address = page_start | ((eeprom_address + 1) & (SIM_EEPROM_PAGE_SIZE - 1));
+
+    return true;
+}
+
+
+/**
+  Data byte read by the master, the address counter rolls over at the end
+  of the 64 KB block.
+
+  @retval           uint8_t               Byte at the address counter.
+
+**/
+uint8_t sim_eeprom_read()
+{
+    if (!eeprom_selected || !eeprom_reading)
+        return 0xFF;
+
+    return sim_eeprom[eeprom_block + eeprom_address++];
+}
+
+
+/**
+  STOP seen on the bus, a filled page buffer starts the internal write cycle.
+
+**/
+void sim_eeprom_stop()
+{
+    uint16_t page_start = eeprom_address & ~(SIM_EEPROM_PAGE_SIZE - 1);
+
+    if (eeprom_page_pending)
+    {
+        for(uint16_t i = 0; i < SIM_EEPROM_PAGE_SIZE; i++)
+        {
+            if (eeprom_page_loaded[i])
+                sim_eeprom[eeprom_block + page_start + i] = eeprom_page_buffer[i];
+        }
+
+        eeprom_busy_until[eeprom_chip] = sim_cycles + sim_eeprom_write_cycle;
+        sim_stats.eeprom_page_writes++;
+    }
+
+    sim_eeprom_start();
+}
@@ -0,0 +1,102 @@
+/**
+  @file
+  iBootLoader - sim/sim_eeprom.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_EEPROM_H
+#define SIM_EEPROM_H
+
+#include <stdint.h>
+
+#include "target_profile.h"
+
+// EEPROM_COUNT chips of EEPROM_TYPE on the bus, from config.json.
+#define SIM_EEPROM_SIZE             EEPROM_SIZE
+#define SIM_EEPROM_PAGE_SIZE        EEPROM_PAGE_SIZE
+#define SIM_EEPROM_I2C_ADDRESS      0x50
+
+
+extern uint8_t  sim_eeprom[SIM_EEPROM_SIZE];
+extern uint64_t sim_eeprom_write_cycle;     // Internal write cycle in CPU cycles, tWC.
+
+
+/**
+  Power on the EEPROMs, all memory bytes are erased to 0xFF.
+
+**/
+void sim_eeprom_init();
+
+
+/**
+  START or repeated START seen on the bus. An unfinished page write without
+  its STOP is dropped.
+
+**/
+void sim_eeprom_start();
+
+
+/**
+  Address byte after a START.
+
+  @param[in]        sla                   7 bit address and R/W bit.
+
+  @retval           true                  Device acknowledged.
+  @retval           false                 No such chip or its write cycle in progress.
+
+**/
+bool sim_eeprom_address(uint8_t sla);
+
+
+/**
+  Data byte written by the master: two memory address bytes, then data for
+  the page buffer.
+
+  @param[in]        data                  Byte on the bus.
+
+  @retval           true                  Device acknowledged.
+
+**/
+bool sim_eeprom_write(uint8_t data);
+
+
+/**
+  Data byte read by the master, the address counter rolls over at the end
+  of the 64 KB block.
+
+  @retval           uint8_t               Byte at the address counter.
+
+**/
+uint8_t sim_eeprom_read();
+
+
+/**
+  STOP seen on the bus, a filled page buffer starts the internal write cycle.
+
+**/
+void sim_eeprom_stop();
+
+#endif //SIM_EEPROM_H
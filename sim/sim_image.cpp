@@ -0,0 +1,496 @@
+/**
+  @file
+  iBootLoader - sim/sim_image.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <string.h>
+
+#include <avr/io.h>
+
+#include "sim_mcu.h"
+#include "sim_eeprom.h"
+#include "sim_image.h"
+#include "crc_lite.h"
+#include "record_ring.h"
+#include "lz_lite.h"
+#include "fast_boot.h"
+
+
+#define SIM_DELTA_MIN_KEEP          3   // DELTA_MIN_KEEP of manage_fwu_eeprom.py
+
+// Match search of the packer, the first LZ_LITE_MIN_MATCH bytes select a hash chain.
+#define SIM_LZ_HASH_SIZE            4096
+#define SIM_LZ_HASH(data)           ((((data)[0] << 8) ^ ((data)[1] << 4) ^ (data)[2]) & (SIM_LZ_HASH_SIZE - 1))
+#define SIM_LZ_MAX_CANDIDATES       64  // LZ_MAX_CANDIDATES of manage_fwu_eeprom.py
+
+
+/**
+  Make a test image, code like data up to the length and blank after it.
+
+  @param[out]       image                 Buffer of SIM_SLOT_SIZE bytes.
+  @param[in]        length                Image length, a multiple of the page size.
+  @param[in]        seed                  Seed of the image content.
+
+**/
+void sim_make_image(uint8_t *image, uint16_t length, uint32_t seed)
+{
+    uint32_t state = seed * 2654435761u;
+
+    memset(image, 0xFF, SIM_SLOT_SIZE);
+
+    // Small values are more likely, as in AVR machine code.
+    for(uint16_t i = 0; i < length; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        image[i] = (state >> 16) & ((state & 0x80000000u) ? 0xFF : 0x1F);
+    }
+}
+
+
+/**
+  Program an image into the application flash, as an ISP programmer would.
+
+  @param[in]        image                 Buffer of SIM_SLOT_SIZE bytes.
+
+**/
+void sim_load_flash(const uint8_t *image)
+{
+    memset(sim_flash, 0xFF, SIM_NRWW_START);
+    memcpy(sim_flash, image, SIM_SLOT_SIZE);
+}
+
+
+/**
+  Make the image header of a raw image, as manage_fwu_eeprom.py does.
+
+  @param[out]       image_header          Image header.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_make_image_header(image_header_t *image_header, const uint8_t *image, uint16_t length)
+{
+    memset(image_header, 0, sizeof(*image_header));
+    image_header->magic         = IMAGE_HEADER_MAGIC;
+    image_header->length        = length;
+    image_header->stored_length = length;
+    image_header->checksum      = crc_lite_update(0, image, length);
+}
+
+
+/**
+  Store an image and its image header in a slot, as manage_fwu_eeprom.py does.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_image(uint8_t slot, const uint8_t *image, uint16_t length)
+{
+    image_header_t image_header;
+
+    memcpy(&sim_eeprom[SIM_SLOT_ADDRESS(slot)], image, length);
+
+    sim_make_image_header(&image_header, image, length);
+    memcpy(&sim_eeprom[SIM_IMAGE_HEADER_PAGE(slot) * SIM_EEPROM_PAGE_SIZE], &image_header, sizeof(image_header));
+}
+
+
+/**
+  Store the first half of an image in a slot, as an upload cut short leaves
+  it. The image header is not written.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+  @param[in]        invalidate            Clear the old image header first, as manage_fwu_eeprom.py does.
+
+**/
+void sim_store_slot_cut_short(uint8_t slot, const uint8_t *image, uint16_t length, bool invalidate)
+{
+    if (invalidate)
+        memset(&sim_eeprom[SIM_IMAGE_HEADER_PAGE(slot) * SIM_EEPROM_PAGE_SIZE], 0, sizeof(uint16_t));
+
+    memcpy(&sim_eeprom[SIM_SLOT_ADDRESS(slot)], image, length / SIM_PAGE_SIZE / 2 * SIM_PAGE_SIZE);
+}
+
+
+/**
+  Store only the pages of an image which hold data and an occupancy map after
+  the image header, as manage_fwu_eeprom.py --occupancy does. Blank pages
+  keep the old content of the slot.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_pages(uint8_t slot, const uint8_t *image, uint16_t length)
+{
+    uint8_t *header_page = &sim_eeprom[SIM_IMAGE_HEADER_PAGE(slot) * SIM_EEPROM_PAGE_SIZE];
+    uint8_t *occupancy_map = &header_page[IMAGE_OCCUPANCY_OFFSET];
+    image_header_t image_header;
+    uint8_t blank[SIM_PAGE_SIZE];
+
+    memset(blank, 0xFF, sizeof(blank));
+    memset(occupancy_map, 0, (length / SIM_PAGE_SIZE + 7) / 8);
+
+    for(uint16_t page = 0; page < length / SIM_PAGE_SIZE; page++)
+    {
+        if (memcmp(&image[page * SIM_PAGE_SIZE], blank, SIM_PAGE_SIZE) == 0)
+            continue;
+
+        memcpy(&sim_eeprom[SIM_SLOT_ADDRESS(slot) + page * SIM_PAGE_SIZE], &image[page * SIM_PAGE_SIZE], SIM_PAGE_SIZE);
+        occupancy_map[page / 8] |= 1 << (page % 8);
+    }
+
+    sim_make_image_header(&image_header, image, length);
+    image_header.flags = IMAGE_FLAG_OCCUPANCY;
+    memcpy(header_page, &image_header, sizeof(image_header));
+}
+
+
+/**
+  Store an image packed by LZSS and its image header in a slot, as
+  manage_fwu_eeprom.py --compress does.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_packed(uint8_t slot, const uint8_t *image, uint16_t length)
+{
+    static uint8_t packed[SIM_SLOT_SIZE + SIM_SLOT_SIZE / 8 + 1];
+    static int32_t chain[SIM_SLOT_SIZE];
+    int32_t head[SIM_LZ_HASH_SIZE];
+    uint16_t packed_length = 0;
+    uint16_t position = 0;
+    image_header_t image_header;
+
+    for(uint16_t index = 0; index < SIM_LZ_HASH_SIZE; index++)
+        head[index] = -1;
+
+    while (position < length)
+    {
+        uint16_t flag_index = packed_length++;
+
+        packed[flag_index] = 0;
+        for(uint8_t bit = 0; bit < 8 && position < length; bit++)
+        {
+            uint16_t max_length = (length - position < LZ_LITE_MAX_MATCH) ? length - position : LZ_LITE_MAX_MATCH;
+            uint16_t best_length = 0;
+            uint16_t best_distance = 0;
+            uint16_t step;
+
+            if (max_length >= LZ_LITE_MIN_MATCH)
+            {
+                int32_t candidate = head[SIM_LZ_HASH(&image[position])];
+
+                for(uint8_t tries = 0; candidate >= 0 && tries < SIM_LZ_MAX_CANDIDATES; tries++)
+                {
+                    uint16_t match_length = 0;
+
+                    if (position - candidate > LZ_LITE_WINDOW_SIZE)
+                        break;
+
+                    while (match_length < max_length && image[candidate + match_length] == image[position + match_length])
+                        match_length++;
+
+                    if (match_length > best_length)
+                    {
+                        best_length   = match_length;
+                        best_distance = position - candidate;
+                        if (match_length == max_length)
+                            break;
+                    }
+                    candidate = chain[candidate];
+                }
+            }
+
+            if (best_length >= LZ_LITE_MIN_MATCH)
+            {
+                packed[packed_length++] = (best_distance - 1) & 0xFF;
+                packed[packed_length++] = (((best_distance - 1) >> 8) << 4) | (best_length - LZ_LITE_MIN_MATCH);
+                step = best_length;
+            }
+            else
+            {
+                packed[flag_index] |= 1 << bit;
+                packed[packed_length++] = image[position];
+                step = 1;
+            }
+
+            for(; step > 0; step--, position++)
+            {
+                if (position + LZ_LITE_MIN_MATCH > length)
+                    continue;
+
+                chain[position] = head[SIM_LZ_HASH(&image[position])];
+                head[SIM_LZ_HASH(&image[position])] = position;
+            }
+        }
+    }
+
+    memcpy(&sim_eeprom[SIM_SLOT_ADDRESS(slot)], packed, packed_length);
+
+    sim_make_image_header(&image_header, packed, packed_length);
+    image_header.length        = length;
+    image_header.flags         = IMAGE_FLAG_COMPRESSED;
+    image_header.base_checksum = crc_lite_update(0, image, length);
+    memcpy(&sim_eeprom[SIM_IMAGE_HEADER_PAGE(slot) * SIM_EEPROM_PAGE_SIZE], &image_header, sizeof(image_header));
+}
+
+
+/**
+  Store the patch from a base image to an image and its image header in a
+  slot, as manage_fwu_eeprom.py --base does.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        base                  Image in the flash, SIM_SLOT_SIZE bytes.
+  @param[in]        image                 Image data, SIM_SLOT_SIZE bytes.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_delta(uint8_t slot, const uint8_t *base, const uint8_t *image, uint16_t length)
+{
+    static uint8_t delta[SIM_SLOT_SIZE];
+    uint16_t delta_length = 0;
+    image_header_t image_header;
+
+    for(uint16_t page = 0; page < SIM_SLOT_SIZE / SIM_PAGE_SIZE; page++)
+    {
+        const uint8_t *old_page = &base[page * SIM_PAGE_SIZE];
+        const uint8_t *new_page = &image[page * SIM_PAGE_SIZE];
+        uint16_t offset = 0;
+
+        if (memcmp(old_page, new_page, SIM_PAGE_SIZE) == 0)
+            continue;
+
+        delta[delta_length++] = page;
+        while (offset < SIM_PAGE_SIZE)
+        {
+            uint16_t keep = 0;
+            uint16_t literal_end;
+
+            while (offset + keep < SIM_PAGE_SIZE && old_page[offset + keep] == new_page[offset + keep])
+                keep++;
+
+            // Short equal runs are cheaper as literals than as a new count pair.
+            literal_end = offset + keep;
+            while (literal_end < SIM_PAGE_SIZE)
+            {
+                uint16_t run = 0;
+
+                while (literal_end + run < SIM_PAGE_SIZE && old_page[literal_end + run] == new_page[literal_end + run])
+                    run++;
+                if (run >= SIM_DELTA_MIN_KEEP || literal_end + run == SIM_PAGE_SIZE)
+                    break;
+                literal_end += run + 1;
+            }
+
+            delta[delta_length++] = keep;
+            delta[delta_length++] = literal_end - offset - keep;
+            memcpy(&delta[delta_length], &new_page[offset + keep], literal_end - offset - keep);
+            delta_length += literal_end - offset - keep;
+            offset = literal_end;
+        }
+    }
+    delta[delta_length++] = DELTA_END_PAGE;
+
+    memcpy(&sim_eeprom[SIM_SLOT_ADDRESS(slot)], delta, delta_length);
+
+    sim_make_image_header(&image_header, delta, delta_length);
+    image_header.length        = length;
+    image_header.flags         = IMAGE_FLAG_DELTA;
+    image_header.base_checksum = crc_lite_update(0, base, SIM_SLOT_SIZE);
+    memcpy(&sim_eeprom[SIM_IMAGE_HEADER_PAGE(slot) * SIM_EEPROM_PAGE_SIZE], &image_header, sizeof(image_header));
+}
+
+
+/**
+  Find the newest record of the config ring.
+
+  @param[out]       newest                Newest record, all 0xFF for an empty ring.
+  @param[out]       next_index            Index of the record after the newest one.
+
+  @retval           true                  Ring holds a valid record.
+  @retval           false                 Ring is empty.
+
+**/
+static bool find_config_record(ring_record_t *newest, uint16_t *next_index)
+{
+    const uint8_t *ring = &sim_eeprom[SIM_CONFIG_RING_PAGE * SIM_EEPROM_PAGE_SIZE];
+    uint16_t record_count = SIM_CONFIG_RING_PAGE_COUNT * RING_RECORDS_PER_PAGE;
+    ring_record_t record;
+    bool found = false;
+
+    memset(newest, 0xFF, sizeof(*newest));
+    *next_index = 0;
+
+    for(uint16_t ring_index = 0; ring_index < record_count; ring_index++)
+    {
+        memcpy(&record, &ring[ring_index * RING_RECORD_SIZE], sizeof(record));
+        if (record.check != (uint8_t)crc_lite_update(0, (uint8_t *)&record, offsetof(ring_record_t, check)))
+            continue;
+
+        if (!found || (int16_t)(record.sequence - newest->sequence) > 0)
+        {
+            *newest     = record;
+            *next_index = (ring_index + 1) % record_count;
+            found       = true;
+        }
+    }
+
+    return found;
+}
+
+
+/**
+  Replace some data bytes of the config as manage_fwu_eeprom.py does: a copy
+  of the newest record of the config ring is appended, or the fixed config
+  page is written while the ring is empty.
+
+  @param[in]        index                 First data byte to set.
+  @param[in]        data                  New data bytes.
+  @param[in]        size                  Number of data bytes to set.
+  @param[in]        to_ring               Append to an empty ring as well.
+
+**/
+static void store_config_data(uint8_t index, const uint8_t *data, uint8_t size, bool to_ring = false)
+{
+    uint8_t *ring = &sim_eeprom[SIM_CONFIG_RING_PAGE * SIM_EEPROM_PAGE_SIZE];
+    ring_record_t record;
+    ring_record_t newest;
+    uint16_t next_index;
+    bool found = find_config_record(&newest, &next_index);
+
+    if (!found && !to_ring)
+    {
+        memcpy(&sim_eeprom[SIM_CONFIG_PAGE * SIM_EEPROM_PAGE_SIZE + index], data, size);
+        return;
+    }
+
+    memset(&record, 0xFF, sizeof(record));
+    record.sequence = found ? newest.sequence + 1 : 0;
+    memcpy(record.data, newest.data, RING_RECORD_DATA_SIZE);
+    memcpy(&record.data[index], data, size);
+    record.check    = crc_lite_update(0, (uint8_t *)&record, offsetof(ring_record_t, check));
+    memcpy(&ring[next_index * RING_RECORD_SIZE], &record, sizeof(record));
+}
+
+
+/**
+  Write a config as manage_fwu_eeprom.py does. The mirror slot of the newest
+  config is kept.
+
+  @param[in]        mode                  FWU mode.
+  @param[in]        slot                  Firmware slot to apply.
+  @param[in]        backup                Backup mode.
+  @param[in]        recovery              Recovery mode.
+
+**/
+void sim_store_config(uint8_t mode, uint8_t slot, uint8_t backup, uint8_t recovery)
+{
+    uint8_t data[] = {mode, slot, backup, recovery};
+
+    store_config_data(0, data, sizeof(data));
+}
+
+
+/**
+  Append the default config to the config ring, as a bootloader with the
+  config ring leaves it after a boot without an update.
+
+**/
+void sim_store_default_config_record()
+{
+    uint8_t data[] = {SIM_FWU_DISABLED, 1, SIM_FWU_ENABLED, SIM_FWU_DISABLED, 0xFF};
+
+    store_config_data(0, data, sizeof(data), true);
+}
+
+
+/**
+  Record the slot which mirrors the running image, as an earlier A/B update
+  leaves it.
+
+  @param[in]        slot                  Firmware slot number, 0xFF for none.
+
+**/
+void sim_store_mirror_slot(uint8_t slot)
+{
+    store_config_data(SIM_CONFIG_MIRROR_SLOT, &slot, 1);
+}
+
+
+/**
+  Read the slot which mirrors the running image from the newest config record.
+
+  @retval           uint8_t               Firmware slot number, 0xFF for none.
+
+**/
+uint8_t sim_read_mirror_slot()
+{
+    ring_record_t newest;
+    uint16_t next_index;
+
+    if (!find_config_record(&newest, &next_index))
+        return sim_eeprom[SIM_CONFIG_PAGE * SIM_EEPROM_PAGE_SIZE + SIM_CONFIG_MIRROR_SLOT];
+    return newest.data[SIM_CONFIG_MIRROR_SLOT];
+}
+
+
+/**
+  Leave the fast boot hint a full boot without a pending update sets.
+
+  @param[in]        armed_since           Newest config record written after the hint.
+
+**/
+void sim_store_fast_boot_hint(bool armed_since)
+{
+    uint16_t record_count = SIM_CONFIG_RING_PAGE_COUNT * RING_RECORDS_PER_PAGE;
+    fast_boot_hint_t hint;
+    ring_record_t newest;
+    uint16_t next_index;
+    bool found = find_config_record(&newest, &next_index);
+
+    hint.next_record   = next_index;
+    hint.next_sequence = found ? newest.sequence + 1 : 0;
+    if (armed_since)
+    {
+        hint.next_record   = (next_index + record_count - 1) % record_count;
+        hint.next_sequence = newest.sequence;
+    }
+
+    hint.check = FAST_BOOT_HINT_KEY;
+    for(uint8_t index = 0; index < offsetof(fast_boot_hint_t, check); index++)
+        hint.check ^= ((uint8_t *)&hint)[index];
+
+    memcpy(&sim_internal_eeprom[FAST_BOOT_HINT_ADDRESS], &hint, sizeof(hint));
+}
@@ -0,0 +1,195 @@
+/**
+  @file
+  iBootLoader - sim/sim_image.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_IMAGE_H
+#define SIM_IMAGE_H
+
+#include <stdint.h>
+
+#include "image_header.h"
+#include "target_profile.h"
+
+// EEPROM layout of the bootloader, see src/target_profile.h and src/iBootLoader.ino.
+#define SIM_SLOT_SIZE               EEPROM_FIRMWARE_SIZE
+#define SIM_SLOT_ADDRESS(slot)      (((slot) - 1) * SIM_SLOT_SIZE)
+#define SIM_CONFIG_PAGE             EEPROM_CONFIG_PAGE_NUMBER
+#define SIM_IMAGE_HEADER_PAGE(slot) (SIM_CONFIG_PAGE + (slot))
+#define SIM_CONFIG_RING_PAGE        (SIM_CONFIG_PAGE + 4)
+#define SIM_CONFIG_RING_PAGE_COUNT  8
+#define SIM_CONFIG_MIRROR_SLOT      4
+
+#define SIM_FWU_ENABLED             0xEE
+#define SIM_FWU_DISABLED            0xDD
+
+
+/**
+  Make a test image, code like data up to the length and blank after it.
+
+  @param[out]       image                 Buffer of SIM_SLOT_SIZE bytes.
+  @param[in]        length                Image length, a multiple of the page size.
+  @param[in]        seed                  Seed of the image content.
+
+**/
+void sim_make_image(uint8_t *image, uint16_t length, uint32_t seed);
+
+
+/**
+  Program an image into the application flash, as an ISP programmer would.
+
+  @param[in]        image                 Buffer of SIM_SLOT_SIZE bytes.
+
+**/
+void sim_load_flash(const uint8_t *image);
+
+
+/**
+  Make the image header of a raw image, as manage_fwu_eeprom.py does.
+
+  @param[out]       image_header          Image header.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_make_image_header(image_header_t *image_header, const uint8_t *image, uint16_t length);
+
+
+/**
+  Store an image and its image header in a slot, as manage_fwu_eeprom.py does.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_image(uint8_t slot, const uint8_t *image, uint16_t length);
+
+
+/**
+  Store the first half of an image in a slot, as an upload cut short leaves
+  it. The image header is not written.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+  @param[in]        invalidate            Clear the old image header first, as manage_fwu_eeprom.py does.
+
+**/
+void sim_store_slot_cut_short(uint8_t slot, const uint8_t *image, uint16_t length, bool invalidate);
+
+
+/**
+  Store only the pages of an image which hold data and an occupancy map after
+  the image header, as manage_fwu_eeprom.py --occupancy does. Blank pages
+  keep the old content of the slot.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_pages(uint8_t slot, const uint8_t *image, uint16_t length);
+
+
+/**
+  Store an image packed by LZSS and its image header in a slot, as
+  manage_fwu_eeprom.py --compress does.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_packed(uint8_t slot, const uint8_t *image, uint16_t length);
+
+
+/**
+  Store the patch from a base image to an image and its image header in a
+  slot, as manage_fwu_eeprom.py --base does.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        base                  Image in the flash, SIM_SLOT_SIZE bytes.
+  @param[in]        image                 Image data, SIM_SLOT_SIZE bytes.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_store_slot_delta(uint8_t slot, const uint8_t *base, const uint8_t *image, uint16_t length);
+
+
+/**
+  Write a config as manage_fwu_eeprom.py does: appended to the config ring,
+  or to the fixed config page while the ring is empty. The mirror slot of
+  the newest config is kept.
+
+  @param[in]        mode                  FWU mode.
+  @param[in]        slot                  Firmware slot to apply.
+  @param[in]        backup                Backup mode.
+  @param[in]        recovery              Recovery mode.
+
+**/
+void sim_store_config(uint8_t mode, uint8_t slot, uint8_t backup, uint8_t recovery);
+
+
+/**
+  Append the default config to the config ring, as a bootloader with the
+  config ring leaves it after a boot without an update.
+
+**/
+void sim_store_default_config_record();
+
+
+/**
+  Record the slot which mirrors the running image, as an earlier A/B update
+  leaves it.
+
+  @param[in]        slot                  Firmware slot number, 0xFF for none.
+
+**/
+void sim_store_mirror_slot(uint8_t slot);
+
+
+/**
+  Read the slot which mirrors the running image from the newest config record.
+
+  @retval           uint8_t               Firmware slot number, 0xFF for none.
+
+**/
+uint8_t sim_read_mirror_slot();
+
+
+/**
+  Leave the fast boot hint a full boot without a pending update sets, naming
+  the config record after the newest one. With armed_since the newest record
+  was appended after that boot, as manage_fwu_eeprom.py arms an update.
+
+  @param[in]        armed_since           Newest config record written after the hint.
+
+**/
+void sim_store_fast_boot_hint(bool armed_since);
+
+#endif //SIM_IMAGE_H
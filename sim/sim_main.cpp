@@ -0,0 +1,188 @@
+/**
+  @file
+  iBootLoader - sim/sim_main.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_mcu.h"
+#include "sim_eeprom.h"
+#include "sim_image.h"
+#include "sim_scenario.h"
+#include "serial_ingest.h"
+#include "boot_timing.h"
+#include "crc_lite.h"
+
+
+static const sim_scenario_t scenarios[] =
+{
+    {"cold boot, no update",     16384,     0, SIM_FWU_ENABLED, true,  false, false, false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+    {"update with backup",       16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+    {"rollback after WDT reset", 16384, 16384, SIM_FWU_ENABLED, false, false, false, false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+    {"rollback, slot 2 cut",     16384, 16384, SIM_FWU_ENABLED, false, false, false, false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_INVALIDATED},
+    {"rollback, stale header",   16384, 16384, SIM_FWU_ENABLED, false, false, false, false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_STALE_HEADER},
+#if COMPRESSION_ENABLE
+    {"compressed update",        16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_COMPRESSED, false, 0, SIM_SLOT_WRITE_NONE},
+#if JOURNAL_ENABLE
+    {"compressed, power loss",   16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_COMPRESSED, false, 40, SIM_SLOT_WRITE_NONE},
+#endif
+#endif
+#if DELTA_ENABLE
+    {"delta update",             16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 4, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_DELTA, false, 0, SIM_SLOT_WRITE_NONE},
+    {"delta, power loss",        16384, 16384, SIM_FWU_ENABLED, true,  false, false, false, 0, 4, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_DELTA, false, 2, SIM_SLOT_WRITE_NONE},
+#endif
+#if SERIAL_INGEST_ENABLE
+    {"update over serial",       16384, 16384, SIM_FWU_ENABLED, true,  true,  true,  false, 0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+#endif
+#if BOOT_SERVICES_ENABLE
+    {"update staged by the app", 16384, 16384, SIM_FWU_ENABLED, true,  true,  false, true,  0, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+#endif
+#if DIFF_BACKUP_ENABLE
+    {"update, 4 pages changed",  16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 4, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+    {"rollback, 4 pages changed", 16384, 16384, SIM_FWU_ENABLED, false, false, false, false, 0, 4, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+#endif
+#if OCCUPANCY_MAP_ENABLE
+    {"update, half blank, map",  16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 0, true,  false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+#endif
+#if FAST_BOOT_ENABLE
+    {"cold boot, fast path",     16384,     0, SIM_FWU_ENABLED, true,  false, false, false, 0, 0, false, true,  SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+    {"update, external reset",   16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 0, false, true,  SIM_RESET_EXTERNAL, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+    {"update armed, power on",   16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 0, false, true,  SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+#endif
+#if AB_SLOTS_ENABLE
+    {"A/B update, no backup",    16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 2, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+    {"A/B rollback",             16384, 16384, SIM_FWU_ENABLED, false, false, false, false, 1, 0, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_RAW, false, 0, SIM_SLOT_WRITE_NONE},
+#if DELTA_ENABLE
+    {"A/B delta, next rollback", 16384, 16384, SIM_FWU_ENABLED, true,  true,  false, false, 0, 4, false, false, SIM_RESET_POWER_ON, SIM_IMAGE_DELTA, true, 0, SIM_SLOT_WRITE_NONE},
+#endif
+#endif
+};
+
+
+#if BOOT_TIMING_ENABLE
+
+/**
+  Print the newest record of the boot timing ring, the phase times measured
+  by the bootloader with Timer1.
+
+  @param[in]        boot                  Boot number in the scenario.
+
+**/
+static void print_boot_timing(uint8_t boot)
+{
+    const uint8_t *ring = &sim_eeprom[BOOT_TIMING_PAGE_NUMBER * SIM_EEPROM_PAGE_SIZE];
+    uint16_t record_count = BOOT_TIMING_PAGE_COUNT * SIM_EEPROM_PAGE_SIZE / sizeof(boot_timing_record_t);
+    boot_timing_record_t record;
+    boot_timing_record_t newest = {};
+    bool found = false;
+
+    for(uint16_t index = 0; index < record_count; index++)
+    {
+        memcpy(&record, &ring[index * sizeof(record)], sizeof(record));
+        if (record.check != (uint8_t)crc_lite_update(0, (uint8_t *)&record, offsetof(boot_timing_record_t, check)))
+            continue;
+
+        if (!found || (int16_t)(record.sequence - newest.sequence) > 0)
+        {
+            newest = record;
+            found  = true;
+        }
+    }
+
+    if (!found)
+    {
+        printf("  boot %u: no timing record\n", boot);
+        return;
+    }
+
+    printf("  boot %u: timing record %u, ms per phase", boot, newest.sequence);
+    for(uint8_t phase = 0; phase < BOOT_PHASE_JUMP; phase++)
+        printf(" %.2f", newest.ticks[phase] * 1024.0 / (F_CPU / 1000));
+    printf("\n");
+}
+
+#endif
+
+
+/**
+  Print the counters of one boot.
+
+  @param[in]        scenario              Scenario of the boot.
+  @param[in]        boot                  Boot number in the scenario.
+  @param[in]        result                Result of sim_boot().
+
+**/
+static void print_boot(const sim_scenario_t *scenario, uint8_t boot, uint8_t result)
+{
+    uint64_t cycles = sim_boot_end.cycles - sim_phase_marks[0].cycles;
+
+    if (boot == 1)
+        printf("%s\n", scenario->name);
+
+    // A fast boot is below a millisecond, it is shown in microseconds.
+    printf("  boot %u: %-11s %9.2f %s  i2c %5u starts %6u bytes %5u nacks  "
+           "eeprom %3u writes  flash %3u erases %3u writes  uart %4u bytes\n",
+           boot, result == SIM_BOOT_APPLICATION ? "application" :
+                 result == SIM_BOOT_POWER_LOSS  ? "power loss"  : "wdt reset",
+           cycles < SIM_MS(1) ? cycles / (double)SIM_US(1) : cycles / (double)SIM_MS(1),
+           cycles < SIM_MS(1) ? "us" : "ms",
+           sim_stats.i2c_starts, sim_stats.i2c_bytes, sim_stats.i2c_address_nacks,
+           sim_stats.eeprom_page_writes, sim_stats.flash_erases, sim_stats.flash_writes,
+           sim_stats.uart_bytes);
+
+    if (sim_stats.spm_violations || sim_stats.rww_violations)
+        printf("  boot %u: %u SPM and %u RWW access violations\n",
+               boot, sim_stats.spm_violations, sim_stats.rww_violations);
+
+    if (sim_stats.uart_rx_bytes)
+        printf("  boot %u: serial %6u bytes received %6u bytes overrun %6u bytes at another baud rate\n",
+               boot, sim_stats.uart_rx_bytes, sim_stats.uart_rx_overruns, sim_stats.uart_rx_errors);
+
+#if BOOT_TIMING_ENABLE
+    if (result == SIM_BOOT_APPLICATION)
+        print_boot_timing(boot);
+#endif
+}
+
+
+int main(int argc, char *argv[])
+{
+    bool passed = true;
+
+    if (argc > 1 && strcmp(argv[1], "-v") == 0)
+        sim_uart_output = stdout;
+
+    for(size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    {
+        if (!sim_run_scenario(&scenarios[i], print_boot))
+            passed = false;
+    }
+
+    return passed ? 0 : 1;
+}
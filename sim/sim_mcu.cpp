@@ -0,0 +1,865 @@
+/**
+  @file
+  iBootLoader - sim/sim_mcu.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <setjmp.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <avr/io.h>
+#include <util/twi.h>
+
+#include "sim_mcu.h"
+#include "sim_eeprom.h"
+#include "boot_timing.h"
+
+
+// Entry point of the bootloader, its main() is renamed by the build.
+int bootloader_main();
+
+// Static variables of the bootloader, gathered in one section by the build.
+extern uint8_t __start_sim_boot_state[];
+extern uint8_t __stop_sim_boot_state[];
+
+
+uint64_t         sim_cycles;
+sim_stats_t      sim_stats;
+sim_phase_mark_t sim_phase_marks[SIM_PHASE_MAX];
+sim_phase_mark_t sim_boot_end;
+uint8_t     sim_flash[SIM_FLASH_SIZE];
+uint8_t     sim_internal_eeprom[SIM_INTERNAL_EEPROM_SIZE];
+FILE       *sim_uart_output;
+void      (*sim_uart_transmit_hook)(uint8_t value, uint64_t frame_cycles);
+
+static uint8_t  registers[SIM_REGISTER_COUNT];
+
+static jmp_buf  boot_jump;
+static bool     boot_running;
+
+static bool     twi_pending;
+static uint64_t twi_done_at;
+static uint8_t  twi_status;
+static uint64_t twi_stop_at;
+static bool     twi_bus_owned;
+static bool     twi_address_phase;
+static bool     twi_reading;
+static bool     twi_selected;
+
+static uint64_t uart_data_empty_at;
+static uint64_t uart_shift_done_at;
+
+#define SIM_UART_LINE_SIZE          4096
+#define SIM_UART_RX_BUFFER_SIZE     2
+
+typedef struct
+{
+    uint64_t done_at;                       // End of the stop bit.
+    uint64_t frame_cycles;
+    uint8_t  value;
+} sim_uart_line_byte_t;
+
+static sim_uart_line_byte_t uart_line[SIM_UART_LINE_SIZE];
+static uint16_t uart_line_head;
+static uint16_t uart_line_count;
+static uint8_t  uart_rx_buffer[SIM_UART_RX_BUFFER_SIZE];
+static uint8_t  uart_rx_count;
+
+static bool     wdt_enabled;
+static uint64_t wdt_deadline;
+
+static uint64_t timer1_base;
+static uint32_t timer1_count_at_base;
+static uint8_t  timer1_high_temp;
+
+static uint8_t  spm_buffer[SIM_PAGE_SIZE];
+static uint64_t spm_busy_until;
+static bool     rww_busy;
+
+static uint64_t internal_eeprom_busy_until;
+
+static uint8_t *boot_state_image;
+
+static uint32_t power_loss_erases;
+
+
+/**
+  Let simulated time pass. A due watchdog reset leaves the running boot.
+
+  @param[in]        cycles                CPU cycles.
+
+**/
+void sim_advance(uint64_t cycles)
+{
+    sim_cycles += cycles;
+
+    if (boot_running && wdt_enabled && sim_cycles >= wdt_deadline)
+    {
+        boot_running = false;
+        longjmp(boot_jump, SIM_BOOT_WATCHDOG_RESET);
+    }
+}
+
+
+/**
+  Get the SCL period from the TWI bit rate registers.
+
+  @retval           uint64_t              SCL period in CPU cycles.
+
+**/
+static uint64_t get_twi_bit_cycles()
+{
+    static const uint8_t prescaler[4] = {1, 4, 16, 64};
+
+    return 16 + 2 * registers[SIM_TWBR] * prescaler[registers[SIM_TWSR] & 0x03];
+}
+
+
+/**
+  Run the bus action requested by a TWCR write with TWINT set.
+
+  @param[in]        value                 Value written to TWCR.
+
+**/
+static void start_twi_action(uint8_t value)
+{
+    uint64_t bit_cycles = get_twi_bit_cycles();
+    bool ack;
+
+    if (value & _BV(TWSTA))
+    {
+        sim_stats.i2c_starts++;
+        sim_eeprom_start();
+        twi_status        = twi_bus_owned ? TW_REP_START : TW_START;
+        twi_bus_owned     = true;
+        twi_address_phase = true;
+        twi_done_at       = sim_cycles + bit_cycles;
+    }
+    else if (value & _BV(TWSTO))
+    {
+        sim_eeprom_stop();
+        twi_bus_owned = false;
+        twi_stop_at   = sim_cycles + bit_cycles;
+        registers[SIM_TWCR] |= _BV(TWSTO);
+        return;
+    }
+    else
+    {
+        sim_stats.i2c_bytes++;
+
+        if (twi_address_phase)
+        {
+            twi_address_phase = false;
+            twi_reading       = registers[SIM_TWDR] & TW_READ;
+            twi_selected      = sim_eeprom_address(registers[SIM_TWDR]);
+            if (!twi_selected)
+                sim_stats.i2c_address_nacks++;
+
+            if (twi_reading)
+                twi_status = twi_selected ? TW_MR_SLA_ACK : TW_MR_SLA_NACK;
+            else
+                twi_status = twi_selected ? TW_MT_SLA_ACK : TW_MT_SLA_NACK;
+        }
+        else if (!twi_reading)
+        {
+            ack = twi_selected && sim_eeprom_write(registers[SIM_TWDR]);
+            twi_status = ack ? TW_MT_DATA_ACK : TW_MT_DATA_NACK;
+        }
+        else
+        {
+            registers[SIM_TWDR] = twi_selected ? sim_eeprom_read() : 0xFF;
+            twi_status = (value & _BV(TWEA)) ? TW_MR_DATA_ACK : TW_MR_DATA_NACK;
+        }
+
+        // Eight data bits and the acknowledge bit.
+        twi_done_at = sim_cycles + 9 * bit_cycles;
+    }
+
+    twi_pending = true;
+    registers[SIM_TWSR] = (registers[SIM_TWSR] & 0x03) | TW_NO_INFO;
+}
+
+
+/**
+  Update the TWI flags which change with time.
+
+**/
+static void update_twi()
+{
+    if (twi_pending && sim_cycles >= twi_done_at)
+    {
+        twi_pending = false;
+        registers[SIM_TWCR] |= _BV(TWINT);
+        registers[SIM_TWSR]  = (registers[SIM_TWSR] & 0x03) | twi_status;
+    }
+
+    if ((registers[SIM_TWCR] & _BV(TWSTO)) && sim_cycles >= twi_stop_at)
+        registers[SIM_TWCR] &= ~_BV(TWSTO);
+}
+
+
+/**
+  Get the time of one UART frame, start bit, 8 data bits and stop bit.
+
+  @retval           uint64_t              Frame time in CPU cycles.
+
+**/
+static uint64_t get_uart_frame_cycles()
+{
+    uint16_t ubrr    = (registers[SIM_UBRR0H] << 8) | registers[SIM_UBRR0L];
+    uint8_t  divider = (registers[SIM_UCSR0A] & _BV(U2X0)) ? 8 : 16;
+
+    return 10ULL * divider * (ubrr + 1);
+}
+
+
+/**
+  Move the bytes that arrived on the line into the receive buffer.
+
+**/
+static void update_uart_receiver()
+{
+    sim_uart_line_byte_t *line_byte;
+
+    while (uart_line_count && uart_line[uart_line_head].done_at <= sim_cycles)
+    {
+        line_byte       = &uart_line[uart_line_head];
+        uart_line_head  = (uart_line_head + 1) % SIM_UART_LINE_SIZE;
+        uart_line_count--;
+
+        if (!(registers[SIM_UCSR0B] & _BV(RXEN0)) || line_byte->frame_cycles != get_uart_frame_cycles())
+        {
+            sim_stats.uart_rx_errors++;
+            continue;
+        }
+
+        if (uart_rx_count == SIM_UART_RX_BUFFER_SIZE)
+        {
+            registers[SIM_UCSR0A] |= _BV(DOR0);
+            sim_stats.uart_rx_overruns++;
+            continue;
+        }
+
+        uart_rx_buffer[uart_rx_count++] = line_byte->value;
+    }
+}
+
+
+/**
+  Send bytes to the UART receiver, back to back after the bytes already on the
+  line. A byte arriving at another baud rate than the receiver uses, or while
+  both receive buffer bytes are unread, is lost.
+
+  @param[in]        data                  Bytes to send.
+  @param[in]        length                Number of bytes.
+  @param[in]        start                 Earliest time of the first start bit.
+  @param[in]        frame_cycles          Frame time of the sender baud rate.
+
+**/
+void sim_uart_send(const uint8_t *data, uint16_t length, uint64_t start, uint64_t frame_cycles)
+{
+    uint64_t done_at = start;
+    uint16_t index;
+
+    if (uart_line_count)
+    {
+        index = (uart_line_head + uart_line_count - 1) % SIM_UART_LINE_SIZE;
+        if (uart_line[index].done_at > done_at)
+            done_at = uart_line[index].done_at;
+    }
+
+    for(uint16_t i = 0; i < length && uart_line_count < SIM_UART_LINE_SIZE; i++)
+    {
+        done_at += frame_cycles;
+        index = (uart_line_head + uart_line_count) % SIM_UART_LINE_SIZE;
+        uart_line[index].done_at      = done_at;
+        uart_line[index].frame_cycles = frame_cycles;
+        uart_line[index].value        = data[i];
+        uart_line_count++;
+    }
+}
+
+
+/**
+  Drop the bytes the sender has queued but not started yet.
+
+**/
+void sim_uart_cancel()
+{
+    update_uart_receiver();
+
+    // The byte on the line finishes.
+    if (uart_line_count && uart_line[uart_line_head].done_at - uart_line[uart_line_head].frame_cycles < sim_cycles)
+        uart_line_count = 1;
+    else
+        uart_line_count = 0;
+}
+
+
+/**
+  Run an internal EEPROM access from an EECR write. EERE reads the byte at
+  EEAR into EEDR, EEPE writes EEDR to it if EEMPE was set before. Both are
+  ignored while a write cycle runs, as on the real part.
+
+  @param[in]        value                 Value written to EECR.
+
+**/
+static void write_eecr(uint8_t value)
+{
+    uint16_t address = (registers[SIM_EEARL] | (registers[SIM_EEARH] << 8)) % SIM_INTERNAL_EEPROM_SIZE;
+    bool write_enabled = registers[SIM_EECR] & _BV(EEMPE);
+
+    registers[SIM_EECR] = value & ~(_BV(EERE) | _BV(EEPE));
+
+    if (sim_cycles < internal_eeprom_busy_until)
+        return;
+
+    if (value & _BV(EERE))
+    {
+        // The CPU is halted for four cycles by a read.
+        sim_advance(4);
+        registers[SIM_EEDR] = sim_internal_eeprom[address];
+    }
+
+    if ((value & _BV(EEPE)) && write_enabled)
+    {
+        sim_internal_eeprom[address] = registers[SIM_EEDR];
+        internal_eeprom_busy_until = sim_cycles + SIM_INTERNAL_EEPROM_CYCLES;
+        registers[SIM_EECR] &= ~_BV(EEMPE);
+    }
+}
+
+
+/**
+  Arm or stop the watchdog from a WDTCSR write.
+
+  @param[in]        value                 Value written to WDTCSR.
+
+**/
+static void write_wdtcsr(uint8_t value)
+{
+    uint8_t prescale;
+
+    // The first write of the timed sequence only opens the change window.
+    if ((value & (_BV(WDCE) | _BV(WDE))) == (_BV(WDCE) | _BV(WDE)))
+        return;
+
+    // WDRF in MCUSR keeps the watchdog on, as on the real part.
+    if (registers[SIM_MCUSR] & _BV(WDRF))
+        value |= _BV(WDE);
+
+    registers[SIM_WDTCSR] = value;
+    wdt_enabled  = value & _BV(WDE);
+    prescale     = (value & 0x07) | ((value & _BV(WDP3)) ? 0x08 : 0);
+    wdt_deadline = sim_cycles + (SIM_MS(16) << prescale);
+}
+
+
+/**
+  Get the Timer1 prescaler from TCCR1B.
+
+  @retval           uint16_t              CPU cycles per count, 0 if stopped.
+
+**/
+static uint16_t get_timer1_divider()
+{
+    static const uint16_t prescaler[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+
+    return prescaler[registers[SIM_TCCR1B] & 0x07];
+}
+
+
+/**
+  Get the Timer1 count since the last write of TCNT1, TCCR1B or TOV1.
+  Counts above 0xFFFF mean the counter overflowed.
+
+  @retval           uint32_t              Timer1 count.
+
+**/
+static uint32_t get_timer1_count()
+{
+    uint16_t divider = get_timer1_divider();
+
+    if (divider == 0)
+        return timer1_count_at_base;
+
+    return timer1_count_at_base + (sim_cycles - timer1_base) / divider;
+}
+
+
+/**
+  Restart Timer1 counting from a new count. An overflow since the last
+  restart is kept in TOV1. The prescaler keeps running, as on the real part.
+
+  @param[in]        count                 New Timer1 count.
+
+**/
+static void set_timer1_count(uint16_t count)
+{
+    if (get_timer1_count() > 0xFFFF)
+        registers[SIM_TIFR1] |= _BV(TOV1);
+
+    if (get_timer1_divider())
+        timer1_base = sim_cycles - (sim_cycles - timer1_base) % get_timer1_divider();
+    else
+        timer1_base = sim_cycles;
+
+    timer1_count_at_base = count;
+}
+
+
+/**
+  Read an emulated register.
+
+  @param[in]        id                    Register id.
+
+  @retval           uint8_t               Register value.
+
+**/
+uint8_t sim_register_read(uint8_t id)
+{
+    sim_advance(SIM_REGISTER_ACCESS_CYCLES);
+
+    switch (id)
+    {
+    case SIM_TWCR:
+    case SIM_TWSR:
+        update_twi();
+        break;
+
+    case SIM_UCSR0A:
+        registers[id] &= ~(_BV(UDRE0) | _BV(TXC0) | _BV(RXC0));
+        if (sim_cycles >= uart_data_empty_at)
+            registers[id] |= _BV(UDRE0);
+        if (sim_cycles >= uart_shift_done_at)
+            registers[id] |= _BV(TXC0);
+        update_uart_receiver();
+        if (uart_rx_count)
+            registers[id] |= _BV(RXC0);
+        break;
+
+    case SIM_UDR0:
+        update_uart_receiver();
+        if (uart_rx_count == 0)
+            return 0;
+
+        registers[id] = uart_rx_buffer[0];
+        uart_rx_buffer[0] = uart_rx_buffer[1];
+        uart_rx_count--;
+        registers[SIM_UCSR0A] &= ~_BV(DOR0);
+        sim_stats.uart_rx_bytes++;
+        break;
+
+    case SIM_SPMCSR:
+        return sim_boot_spm_busy() ? 0x01 : 0x00;
+
+    // Reading the low byte latches the high byte.
+    case SIM_TCNT1L:
+        timer1_high_temp = (get_timer1_count() >> 8) & 0xFF;
+        return get_timer1_count() & 0xFF;
+
+    case SIM_TCNT1H:
+        return timer1_high_temp;
+
+    case SIM_TIFR1:
+        set_timer1_count(get_timer1_count() & 0xFFFF);
+        break;
+
+    case SIM_EECR:
+        return registers[id] | ((sim_cycles < internal_eeprom_busy_until) ? _BV(EEPE) : 0);
+    }
+
+    return registers[id];
+}
+
+
+/**
+  Write an emulated register.
+
+  @param[in]        id                    Register id.
+  @param[in]        value                 Register value.
+
+**/
+void sim_register_write(uint8_t id, uint8_t value)
+{
+    uint64_t frame_start;
+
+    sim_advance(SIM_REGISTER_ACCESS_CYCLES);
+
+    switch (id)
+    {
+    case SIM_TWCR:
+        update_twi();
+        registers[id] = (registers[id] & _BV(TWINT) & ~value) | (value & ~_BV(TWINT));
+        if ((value & _BV(TWINT)) && (value & _BV(TWEN)))
+        {
+            registers[id] &= ~_BV(TWINT);
+            start_twi_action(value);
+        }
+        break;
+
+    case SIM_TWSR:
+        registers[id] = (registers[id] & TW_STATUS_MASK) | (value & 0x03);
+        break;
+
+    case SIM_UDR0:
+        if (!(registers[SIM_UCSR0B] & _BV(TXEN0)))
+            break;
+
+        frame_start        = (sim_cycles > uart_shift_done_at) ? sim_cycles : uart_shift_done_at;
+        uart_data_empty_at = frame_start;
+        uart_shift_done_at = frame_start + get_uart_frame_cycles();
+        sim_stats.uart_bytes++;
+        if (sim_uart_output)
+            fputc(value, sim_uart_output);
+        if (sim_uart_transmit_hook)
+            sim_uart_transmit_hook(value, get_uart_frame_cycles());
+        break;
+
+    case SIM_UCSR0A:
+        update_uart_receiver();
+        registers[id] = (registers[id] & ~(_BV(U2X0) | _BV(MPCM0))) | (value & (_BV(U2X0) | _BV(MPCM0)));
+        break;
+
+    // Bytes on the line arrived with the old settings.
+    case SIM_UCSR0B:
+    case SIM_UBRR0L:
+    case SIM_UBRR0H:
+        update_uart_receiver();
+        registers[id] = value;
+        if (id == SIM_UCSR0B && !(value & _BV(RXEN0)))
+            uart_rx_count = 0;
+        break;
+
+    case SIM_WDTCSR:
+        write_wdtcsr(value);
+        break;
+
+    case SIM_EECR:
+        write_eecr(value);
+        break;
+
+    case SIM_TCCR1B:
+        set_timer1_count(get_timer1_count() & 0xFFFF);
+        registers[id] = value;
+        break;
+
+    // Writing the low byte takes the high byte written before.
+    case SIM_TCNT1L:
+        set_timer1_count((timer1_high_temp << 8) | value);
+        break;
+
+    case SIM_TCNT1H:
+        timer1_high_temp = value;
+        break;
+
+    case SIM_TIFR1:
+        set_timer1_count(get_timer1_count() & 0xFFFF);
+        registers[id] &= ~value;
+        break;
+
+    default:
+        registers[id] = value;
+        break;
+    }
+}
+
+
+/**
+  Fill one word of the SPM temporary page buffer.
+
+  @param[in]        address               Flash byte address.
+  @param[in]        data                  Word to fill.
+
+**/
+void sim_boot_page_fill(uint32_t address, uint16_t data)
+{
+    sim_advance(SIM_REGISTER_ACCESS_CYCLES);
+
+    if (sim_cycles < spm_busy_until)
+        sim_stats.spm_violations++;
+
+    spm_buffer[address & (SIM_PAGE_SIZE - 2)]     = data & 0xFF;
+    spm_buffer[(address & (SIM_PAGE_SIZE - 2)) + 1] = data >> 8;
+}
+
+
+/**
+  Erase one flash page.
+
+  @param[in]        address               Flash byte address inside the page.
+
+**/
+void sim_boot_page_erase(uint32_t address)
+{
+    sim_advance(SIM_REGISTER_ACCESS_CYCLES);
+
+    if (sim_cycles < spm_busy_until)
+        sim_stats.spm_violations++;
+
+    memset(&sim_flash[(address % SIM_FLASH_SIZE) & ~(SIM_PAGE_SIZE - 1)], 0xFF, SIM_PAGE_SIZE);
+    sim_stats.flash_erases++;
+    spm_busy_until = sim_cycles + SIM_SPM_CYCLES;
+    rww_busy = true;
+
+    if (boot_running && sim_stats.flash_erases == power_loss_erases)
+    {
+        boot_running = false;
+        longjmp(boot_jump, SIM_BOOT_POWER_LOSS);
+    }
+}
+
+
+/**
+  Write the SPM temporary page buffer into one flash page. The buffer is
+  blank again afterwards.
+
+  @param[in]        address               Flash byte address inside the page.
+
+**/
+void sim_boot_page_write(uint32_t address)
+{
+    sim_advance(SIM_REGISTER_ACCESS_CYCLES);
+
+    if (sim_cycles < spm_busy_until)
+        sim_stats.spm_violations++;
+
+    memcpy(&sim_flash[(address % SIM_FLASH_SIZE) & ~(SIM_PAGE_SIZE - 1)], spm_buffer, SIM_PAGE_SIZE);
+    memset(spm_buffer, 0xFF, sizeof(spm_buffer));
+    sim_stats.flash_writes++;
+    spm_busy_until = sim_cycles + SIM_SPM_CYCLES;
+    rww_busy = true;
+}
+
+
+/**
+  Make the RWW section readable again after an erase or write.
+
+**/
+void sim_boot_rww_enable()
+{
+    sim_advance(SIM_REGISTER_ACCESS_CYCLES);
+
+    if (sim_cycles < spm_busy_until)
+        sim_stats.spm_violations++;
+
+    rww_busy = false;
+}
+
+
+/**
+  Check whether an erase or write is still running.
+
+  @retval           true                  SPM busy.
+  @retval           false                 SPM ready.
+
+**/
+uint8_t sim_boot_spm_busy()
+{
+    sim_advance(SIM_REGISTER_ACCESS_CYCLES);
+    return sim_cycles < spm_busy_until;
+}
+
+
+/**
+  Read one flash byte with LPM.
+
+  @param[in]        address               Flash byte address.
+
+  @retval           uint8_t               Flash byte.
+
+**/
+uint8_t sim_flash_read(uint32_t address)
+{
+    sim_advance(SIM_FLASH_READ_CYCLES);
+
+    if (address < SIM_NRWW_START && rww_busy)
+        sim_stats.rww_violations++;
+
+    return sim_flash[address % SIM_FLASH_SIZE];
+}
+
+
+/**
+  Record time and counters in a phase mark.
+
+  @param[out]       mark                  Phase mark.
+
+**/
+static void set_phase_mark(sim_phase_mark_t *mark)
+{
+    mark->reached = true;
+    mark->cycles  = sim_cycles;
+    mark->stats   = sim_stats;
+}
+
+
+/**
+  Mark the start of a boot phase, the target of BOOT_PHASE().
+
+  @param[in]        phase                 BOOT_PHASE_* of src/ialoy_code.h.
+
+**/
+void sim_boot_phase(uint8_t phase)
+{
+    if (phase < SIM_PHASE_MAX)
+        set_phase_mark(&sim_phase_marks[phase]);
+
+#if BOOT_TIMING_ENABLE
+    mark_boot_phase(phase);
+#endif
+}
+
+
+/**
+  Reset the MCU. Registers and counters are cleared, flash and EEPROM are kept.
+  A watchdog reset leaves the watchdog enabled, as on the real part.
+
+  The static variables of the bootloader get their initial values back, as
+  the startup code of the target loads .data and clears .bss. The first call
+  keeps a copy of them.
+
+  @param[in]        cause                 SIM_RESET_POWER_ON, SIM_RESET_WATCHDOG or SIM_RESET_EXTERNAL.
+
+**/
+void sim_reset(uint8_t cause)
+{
+    memset(registers, 0, sizeof(registers));
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    memset(sim_phase_marks, 0, sizeof(sim_phase_marks));
+    memset(&sim_boot_end, 0, sizeof(sim_boot_end));
+    memset(spm_buffer, 0xFF, sizeof(spm_buffer));
+    power_loss_erases = 0;
+
+    size_t boot_state_size = __stop_sim_boot_state - __start_sim_boot_state;
+    if (boot_state_image == NULL)
+    {
+        boot_state_image = (uint8_t *)malloc(boot_state_size);
+        memcpy(boot_state_image, __start_sim_boot_state, boot_state_size);
+    }
+    memcpy(__start_sim_boot_state, boot_state_image, boot_state_size);
+
+    registers[SIM_TWSR]   = TW_NO_INFO;
+    registers[SIM_UCSR0A] = _BV(UDRE0);
+    registers[SIM_MCUSR]  = (cause == SIM_RESET_WATCHDOG) ? _BV(WDRF) :
+                            (cause == SIM_RESET_EXTERNAL) ? _BV(EXTRF) : _BV(PORF);
+
+    twi_pending        = false;
+    twi_bus_owned      = false;
+    uart_data_empty_at = sim_cycles;
+    uart_shift_done_at = sim_cycles;
+    uart_rx_count      = 0;
+    spm_busy_until     = sim_cycles;
+    rww_busy           = false;
+
+    timer1_base          = sim_cycles;
+    timer1_count_at_base = 0;
+
+    sim_eeprom_start();
+
+    wdt_enabled = false;
+    if (cause == SIM_RESET_WATCHDOG)
+        write_wdtcsr(_BV(WDE));
+
+    set_phase_mark(&sim_phase_marks[0]);
+}
+
+
+/**
+  Run the bootloader from the reset vector until it jumps to the application
+  or the watchdog resets the MCU.
+
+  @retval           SIM_BOOT_APPLICATION      Bootloader jumped to the application.
+  @retval           SIM_BOOT_WATCHDOG_RESET   Watchdog reset during the boot.
+  @retval           SIM_BOOT_RETURNED         Bootloader main() returned.
+  @retval           SIM_BOOT_POWER_LOSS       Power failed during the boot.
+
+**/
+uint8_t sim_boot()
+{
+    volatile uint8_t result = setjmp(boot_jump);
+
+    if (result == 0)
+    {
+        boot_running = true;
+        bootloader_main();
+        result = SIM_BOOT_RETURNED;
+    }
+
+    boot_running = false;
+    set_phase_mark(&sim_boot_end);
+    return result;
+}
+
+
+/**
+  Let the power fail right after a page erase of the next boot, the erased
+  page is left blank. Call after sim_reset().
+
+  @param[in]        erase_count           Page erases before the power fails, 0 for none.
+
+**/
+void sim_set_power_loss(uint32_t erase_count)
+{
+    power_loss_erases = erase_count;
+}
+
+
+/**
+  Let the application run for some time. An application which does not
+  stop the watchdog is reset by it.
+
+  @param[in]        ms                    Run time in milliseconds.
+
+  @retval           true                  Watchdog reset the MCU.
+  @retval           false                 Application is still running.
+
+**/
+bool sim_run_application(uint32_t ms)
+{
+    uint64_t end = sim_cycles + SIM_MS(ms);
+
+    if (wdt_enabled && wdt_deadline <= end)
+    {
+        sim_cycles = wdt_deadline;
+        return true;
+    }
+
+    sim_cycles = end;
+    return false;
+}
+
+
+/**
+  Application entry point of the simulation, the target of jump_to_application().
+
+**/
+void sim_application_entry(void)
+{
+    boot_running = false;
+    longjmp(boot_jump, SIM_BOOT_APPLICATION);
+}
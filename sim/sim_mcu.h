@@ -0,0 +1,309 @@
+/**
+  @file
+  iBootLoader - sim/sim_mcu.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_MCU_H
+#define SIM_MCU_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef F_CPU
+#define F_CPU 16000000UL
+#endif
+
+#define SIM_FLASH_SIZE              32768
+#define SIM_NRWW_START              0x7000
+#define SIM_PAGE_SIZE               128
+
+#define SIM_CYCLES_PER_US           (F_CPU / 1000000UL)
+#define SIM_US(us)                  ((uint64_t)(us) * SIM_CYCLES_PER_US)
+#define SIM_MS(ms)                  (SIM_US(ms) * 1000)
+
+// CPU cycles charged for one register access, about one polling loop turn.
+#define SIM_REGISTER_ACCESS_CYCLES  4
+// CPU cycles charged for one LPM flash read.
+#define SIM_FLASH_READ_CYCLES       3
+// Page erase and page write time of the ATmega328P, 3.7 ms to 4.5 ms.
+#define SIM_SPM_CYCLES              SIM_US(4100)
+// Internal EEPROM of the ATmega328P and its erase and write time.
+#define SIM_INTERNAL_EEPROM_SIZE    1024
+#define SIM_INTERNAL_EEPROM_CYCLES  SIM_US(3400)
+
+#define SIM_BOOT_APPLICATION        1
+#define SIM_BOOT_WATCHDOG_RESET     2
+#define SIM_BOOT_RETURNED           3
+#define SIM_BOOT_POWER_LOSS         4
+
+#define SIM_RESET_POWER_ON          0
+#define SIM_RESET_WATCHDOG          1
+#define SIM_RESET_EXTERNAL          2
+
+// Phase marks of a boot, mark 0 is the reset.
+#define SIM_PHASE_MAX               16
+
+
+/*
+Register ids of the emulated peripherals. Only the registers used by the
+bootloader are modelled, all others read as plain storage.
+*/
+
+enum
+{
+    SIM_DDRB, SIM_PORTB, SIM_PINB,
+    SIM_DDRD, SIM_PORTD, SIM_PIND,
+    SIM_TWBR, SIM_TWSR, SIM_TWDR, SIM_TWCR,
+    SIM_UCSR0A, SIM_UCSR0B, SIM_UCSR0C, SIM_UBRR0L, SIM_UBRR0H, SIM_UDR0,
+    SIM_WDTCSR, SIM_MCUSR, SIM_SPMCSR,
+    SIM_TCCR1A, SIM_TCCR1B, SIM_TCNT1L, SIM_TCNT1H, SIM_TIFR1,
+    SIM_EEARL, SIM_EEARH, SIM_EEDR, SIM_EECR,
+    SIM_REGISTER_COUNT
+};
+
+
+/*
+Counters of one simulated boot, cleared by sim_reset().
+*/
+
+typedef struct
+{
+    uint32_t i2c_starts;                    // START and repeated START conditions.
+    uint32_t i2c_bytes;                     // Bytes on the bus, address bytes included.
+    uint32_t i2c_address_nacks;             // Address not acknowledged, mostly ACK polls.
+    uint32_t eeprom_page_writes;            // EEPROM internal write cycles.
+    uint32_t flash_erases;
+    uint32_t flash_writes;
+    uint32_t uart_bytes;
+    uint32_t uart_rx_bytes;                 // Bytes taken from the receive buffer.
+    uint32_t uart_rx_errors;                // Bytes at a wrong baud rate or with the receiver off.
+    uint32_t uart_rx_overruns;              // Bytes lost to a full receive buffer.
+    uint32_t spm_violations;                // SPM issued while the previous one is busy.
+    uint32_t rww_violations;                // RWW section read while it is not readable.
+} sim_stats_t;
+
+
+/*
+Time and counters at a BOOT_PHASE() mark of the bootloader.
+*/
+
+typedef struct
+{
+    bool        reached;
+    uint64_t    cycles;
+    sim_stats_t stats;
+} sim_phase_mark_t;
+
+
+extern uint64_t         sim_cycles;
+extern sim_stats_t      sim_stats;
+extern sim_phase_mark_t sim_phase_marks[SIM_PHASE_MAX];
+extern sim_phase_mark_t sim_boot_end;      // Jump to the application or watchdog reset.
+extern uint8_t     sim_flash[SIM_FLASH_SIZE];
+extern uint8_t     sim_internal_eeprom[SIM_INTERNAL_EEPROM_SIZE];
+extern FILE       *sim_uart_output;
+
+// Called for every byte the bootloader sends, with the frame time of its baud rate.
+extern void (*sim_uart_transmit_hook)(uint8_t value, uint64_t frame_cycles);
+
+
+/**
+  Let simulated time pass. A due watchdog reset leaves the running boot.
+
+  @param[in]        cycles                CPU cycles.
+
+**/
+void sim_advance(uint64_t cycles);
+
+
+/**
+  Read an emulated register.
+
+  @param[in]        id                    Register id.
+
+  @retval           uint8_t               Register value.
+
+**/
+uint8_t sim_register_read(uint8_t id);
+
+
+/**
+  Write an emulated register.
+
+  @param[in]        id                    Register id.
+  @param[in]        value                 Register value.
+
+**/
+void sim_register_write(uint8_t id, uint8_t value);
+
+
+/**
+  Proxy for one emulated register, so the bootloader sources can use the
+  register names of avr/io.h unchanged.
+
+**/
+class sim_register
+{
+public:
+    explicit sim_register(uint8_t id) : id(id) {}
+    sim_register(const sim_register &other) = default;
+
+    operator uint8_t() const { return sim_register_read(id); }
+
+    sim_register &operator=(uint8_t value) { sim_register_write(id, value); return *this; }
+    sim_register &operator=(const sim_register &other) { return *this = (uint8_t)other; }
+    sim_register &operator|=(uint8_t value) { return *this = (uint8_t)(*this | value); }
+    sim_register &operator&=(uint8_t value) { return *this = (uint8_t)(*this & value); }
+    sim_register &operator^=(uint8_t value) { return *this = (uint8_t)(*this ^ value); }
+
+private:
+    uint8_t id;
+};
+
+
+/**
+  Proxy for a 16 bit register pair, low byte first as on the real part.
+
+**/
+class sim_register16
+{
+public:
+    explicit sim_register16(uint8_t id_low) : id_low(id_low) {}
+
+    operator uint16_t() const
+    {
+        uint8_t low = sim_register_read(id_low);
+        return low | (sim_register_read(id_low + 1) << 8);
+    }
+
+    sim_register16 &operator=(uint16_t value)
+    {
+        sim_register_write(id_low + 1, value >> 8);
+        sim_register_write(id_low, value & 0xFF);
+        return *this;
+    }
+
+private:
+    uint8_t id_low;
+};
+
+
+/*
+SPM and flash access, used by the avr/boot.h and avr/pgmspace.h shims.
+*/
+
+void    sim_boot_page_fill(uint32_t address, uint16_t data);
+void    sim_boot_page_erase(uint32_t address);
+void    sim_boot_page_write(uint32_t address);
+void    sim_boot_rww_enable();
+uint8_t sim_boot_spm_busy();
+uint8_t sim_flash_read(uint32_t address);
+
+
+/**
+  Mark the start of a boot phase, the target of BOOT_PHASE().
+
+  @param[in]        phase                 BOOT_PHASE_* of src/ialoy_code.h.
+
+**/
+void sim_boot_phase(uint8_t phase);
+
+
+/**
+  Send bytes to the UART receiver, back to back after the bytes already on the
+  line. A byte arriving at another baud rate than the receiver uses, or while
+  both receive buffer bytes are unread, is lost.
+
+  @param[in]        data                  Bytes to send.
+  @param[in]        length                Number of bytes.
+  @param[in]        start                 Earliest time of the first start bit.
+  @param[in]        frame_cycles          Frame time of the sender baud rate.
+
+**/
+void sim_uart_send(const uint8_t *data, uint16_t length, uint64_t start, uint64_t frame_cycles);
+
+
+/**
+  Drop the bytes the sender has queued but not started yet.
+
+**/
+void sim_uart_cancel();
+
+
+/**
+  Reset the MCU. Registers and counters are cleared, flash and EEPROM are kept.
+  A watchdog reset leaves the watchdog enabled, as on the real part.
+
+  @param[in]        cause                 SIM_RESET_POWER_ON, SIM_RESET_WATCHDOG or SIM_RESET_EXTERNAL.
+
+**/
+void sim_reset(uint8_t cause);
+
+
+/**
+  Run the bootloader from the reset vector until it jumps to the application
+  or the watchdog resets the MCU.
+
+  @retval           SIM_BOOT_APPLICATION      Bootloader jumped to the application.
+  @retval           SIM_BOOT_WATCHDOG_RESET   Watchdog reset during the boot.
+  @retval           SIM_BOOT_RETURNED         Bootloader main() returned.
+  @retval           SIM_BOOT_POWER_LOSS       Power failed during the boot.
+
+**/
+uint8_t sim_boot();
+
+
+/**
+  Let the power fail right after a page erase of the next boot, the erased
+  page is left blank. Call after sim_reset().
+
+  @param[in]        erase_count           Page erases before the power fails, 0 for none.
+
+**/
+void sim_set_power_loss(uint32_t erase_count);
+
+
+/**
+  Let the application run for some time. An application which does not
+  stop the watchdog is reset by it.
+
+  @param[in]        ms                    Run time in milliseconds.
+
+  @retval           true                  Watchdog reset the MCU.
+  @retval           false                 Application is still running.
+
+**/
+bool sim_run_application(uint32_t ms);
+
+
+/**
+  Application entry point of the simulation, the target of jump_to_application().
+
+**/
+void sim_application_entry(void);
+
+#endif //SIM_MCU_H
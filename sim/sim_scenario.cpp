@@ -0,0 +1,302 @@
+/**
+  @file
+  iBootLoader - sim/sim_scenario.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <stdio.h>
+#include <string.h>
+
+#include "sim_mcu.h"
+#include "sim_eeprom.h"
+#include "sim_image.h"
+#include "sim_scenario.h"
+#include "sim_uart_host.h"
+#include "watchdog_timer.h"
+#include "boot_services.h"
+#include "fast_boot.h"
+#include "ialoy_code.h"
+
+
+#define SIM_MAX_BOOTS               4
+#define SIM_APPLICATION_RUN_MS      2000
+
+
+#if BOOT_SERVICES_ENABLE
+
+/**
+  Store an image in slot 1 and enable the update as an application does,
+  through the service table of the bootloader.
+
+  @param[in]        image                 Image data.
+  @param[in]        length                Image length, a multiple of the page size.
+
+  @retval           true                  Update committed.
+  @retval           false                 No service table or a service failed.
+
+**/
+static bool stage_update_in_application(const uint8_t *image, uint16_t length)
+{
+    const boot_services_t *services = get_boot_services();
+    image_header_t image_header;
+    uint32_t checksum;
+
+    if (services == NULL)
+        return false;
+
+    for(uint16_t page = 0; page < length / SIM_PAGE_SIZE; page++)
+    {
+        if (boot_write_slot_page(services, page, &image[page * SIM_PAGE_SIZE]) != RETURN_CODE_SUCCESS)
+            return false;
+    }
+
+    sim_make_image_header(&image_header, image, length);
+
+    return boot_get_slot_checksum(services, length, &checksum) == RETURN_CODE_SUCCESS &&
+           checksum == image_header.checksum &&
+           boot_commit_update(services, &image_header) == RETURN_CODE_SUCCESS;
+}
+#endif
+
+
+/**
+  Confirm the running image as an application does, through the service
+  table of the bootloader when it has one.
+
+  @retval           true                  Config confirmed.
+  @retval           false                 No service table or the service failed.
+
+**/
+static bool confirm_in_application()
+{
+#if BOOT_SERVICES_ENABLE
+    const boot_services_t *services = get_boot_services();
+
+    return services != NULL && boot_confirm_update(services) == RETURN_CODE_SUCCESS;
+#else
+    sim_store_config(SIM_FWU_DISABLED, 1, SIM_FWU_ENABLED, SIM_FWU_DISABLED);
+    return true;
+#endif
+}
+
+
+/**
+  Run one scenario from power on until the application keeps running.
+
+  @param[in]        scenario              Scenario to run.
+  @param[in]        report                Called after every boot.
+
+  @retval           true                  Flash holds the expected image.
+  @retval           false                 Unexpected flash content or access violations.
+
+**/
+bool sim_run_scenario(const sim_scenario_t *scenario, sim_boot_report_t report)
+{
+    static uint8_t running_image[SIM_SLOT_SIZE];
+    static uint8_t update_image[SIM_SLOT_SIZE];
+    static uint8_t second_image[SIM_SLOT_SIZE];
+    uint8_t result;
+    uint8_t reset_cause = scenario->first_reset;
+    bool passed = true;
+    bool confirms;
+    bool second_staged = false;
+    bool armed = false;
+
+    sim_eeprom_init();
+    sim_make_image(running_image, scenario->running_length, 1);
+    sim_load_flash(running_image);
+
+    memset(sim_internal_eeprom, 0xFF, sizeof(sim_internal_eeprom));
+
+    // The full boot which set the fast boot hint left its config in the ring.
+    if (scenario->fast_boot_hint)
+        sim_store_default_config_record();
+
+    if (scenario->application_staging)
+    {
+        sim_make_image(update_image, scenario->update_length, 2);
+        sim_store_config(SIM_FWU_DISABLED, 1, scenario->backup, SIM_FWU_DISABLED);
+    }
+    else if (scenario->serial_ingest)
+    {
+        sim_make_image(update_image, scenario->update_length, 2);
+        sim_uart_host_start(update_image, scenario->update_length);
+        sim_store_config(SIM_FWU_DISABLED, 1, scenario->backup, SIM_FWU_DISABLED);
+    }
+    else if (scenario->update_length)
+    {
+        // The update goes into the slot which does not mirror the running image.
+        uint8_t update_slot = (scenario->mirror_slot == 1) ? 2 : 1;
+
+        sim_make_image(update_image, scenario->update_length, 2);
+        if (scenario->changed_pages)
+        {
+            memcpy(&update_image[scenario->changed_pages * SIM_PAGE_SIZE],
+                   &running_image[scenario->changed_pages * SIM_PAGE_SIZE],
+                   SIM_SLOT_SIZE - scenario->changed_pages * SIM_PAGE_SIZE);
+        }
+
+        if (scenario->image_format == SIM_IMAGE_DELTA)
+        {
+            sim_store_slot_delta(update_slot, running_image, update_image, scenario->update_length);
+        }
+        else if (scenario->image_format == SIM_IMAGE_COMPRESSED)
+        {
+            sim_store_slot_packed(update_slot, update_image, scenario->update_length);
+        }
+        else if (scenario->blank_gap)
+        {
+            // The blank pages of the slot still hold the running image, they must not be read.
+            memset(&update_image[scenario->update_length / 4], 0xFF, scenario->update_length / 2);
+            sim_store_slot_image(update_slot, running_image, scenario->running_length);
+            sim_store_slot_pages(update_slot, update_image, scenario->update_length);
+        }
+        else
+        {
+            sim_store_slot_image(update_slot, update_image, scenario->update_length);
+        }
+        sim_store_config(SIM_FWU_ENABLED, update_slot, scenario->backup, SIM_FWU_DISABLED);
+        armed = true;
+
+        if (scenario->mirror_slot)
+        {
+            sim_store_slot_image(scenario->mirror_slot, running_image, scenario->running_length);
+            sim_store_mirror_slot(scenario->mirror_slot);
+        }
+    }
+    else
+    {
+        sim_store_config(SIM_FWU_DISABLED, 1, scenario->backup, SIM_FWU_DISABLED);
+    }
+
+    // A host write to slot 2 stopped halfway, over a backup of the running image.
+    if (scenario->slot_2_write != SIM_SLOT_WRITE_NONE)
+    {
+        sim_make_image(second_image, scenario->running_length, 4);
+        sim_store_slot_image(2, running_image, scenario->running_length);
+        sim_store_slot_cut_short(2, second_image, scenario->running_length,
+                                 scenario->slot_2_write == SIM_SLOT_WRITE_INVALIDATED);
+    }
+
+    // An armed update was written after the boot which set the hint.
+    if (scenario->fast_boot_hint)
+        sim_store_fast_boot_hint(armed);
+
+    for(uint8_t boot = 1; boot <= SIM_MAX_BOOTS; boot++)
+    {
+        sim_reset(reset_cause);
+        if (boot == 1)
+            sim_set_power_loss(scenario->power_loss_erases);
+        result = sim_boot();
+        report(scenario, boot, result);
+
+        if (sim_stats.spm_violations || sim_stats.rww_violations)
+            passed = false;
+
+        // The host waits for every answer, a byte the bootloader did not pick up in time is a failure.
+        if (sim_stats.uart_rx_overruns)
+        {
+            fprintf(stderr, "%s: %u serial bytes lost to overrun\n", scenario->name, sim_stats.uart_rx_overruns);
+            passed = false;
+        }
+
+        if (result == SIM_BOOT_WATCHDOG_RESET)
+        {
+            reset_cause = SIM_RESET_WATCHDOG;
+            continue;
+        }
+
+        if (result == SIM_BOOT_POWER_LOSS)
+        {
+            reset_cause = SIM_RESET_POWER_ON;
+            continue;
+        }
+
+        if (result != SIM_BOOT_APPLICATION)
+            return false;
+
+        // The running image always confirms, the updated one only if the scenario says so.
+        confirms = memcmp(sim_flash, running_image, SIM_SLOT_SIZE) == 0 ||
+                   (scenario->update_confirms && memcmp(sim_flash, update_image, SIM_SLOT_SIZE) == 0);
+        if (confirms)
+        {
+            disable_watchdog_timer();
+            if (!confirm_in_application())
+            {
+                fprintf(stderr, "%s: application could not confirm\n", scenario->name);
+                passed = false;
+            }
+        }
+
+        // The next update goes into the slot which does not mirror the flash, reset through the RESET pin.
+        if (scenario->second_update && !second_staged && confirms &&
+            memcmp(sim_flash, update_image, SIM_SLOT_SIZE) == 0)
+        {
+            uint8_t second_slot = (sim_read_mirror_slot() == 2) ? 1 : 2;
+
+            sim_make_image(second_image, scenario->update_length, 3);
+            sim_store_slot_image(second_slot, second_image, scenario->update_length);
+            sim_store_config(SIM_FWU_ENABLED, second_slot, scenario->backup, SIM_FWU_DISABLED);
+            second_staged = true;
+            reset_cause   = SIM_RESET_EXTERNAL;
+            continue;
+        }
+
+#if BOOT_SERVICES_ENABLE
+        // The running application stages the update and resets through the watchdog.
+        if (scenario->application_staging && boot == 1)
+        {
+            if (!stage_update_in_application(update_image, scenario->update_length))
+            {
+                fprintf(stderr, "%s: boot services did not stage the update\n", scenario->name);
+                passed = false;
+            }
+            reset_cause = SIM_RESET_WATCHDOG;
+            continue;
+        }
+#endif
+
+        if (!sim_run_application(SIM_APPLICATION_RUN_MS))
+            break;
+
+        // Application did not stop the watchdog, next boot is a watchdog reset.
+        reset_cause = SIM_RESET_WATCHDOG;
+    }
+
+    if (scenario->serial_ingest && !sim_uart_host_stop())
+    {
+        fprintf(stderr, "%s: serial transfer did not complete\n", scenario->name);
+        passed = false;
+    }
+
+    if (memcmp(sim_flash, scenario->expect_update ? update_image : running_image, SIM_SLOT_SIZE) != 0)
+    {
+        fprintf(stderr, "%s: flash does not hold the expected image\n", scenario->name);
+        passed = false;
+    }
+
+    return passed;
+}
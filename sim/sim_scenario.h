@@ -0,0 +1,87 @@
+/**
+  @file
+  iBootLoader - sim/sim_scenario.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_SCENARIO_H
+#define SIM_SCENARIO_H
+
+#include <stdint.h>
+
+
+#define SIM_IMAGE_RAW               0
+#define SIM_IMAGE_DELTA             1   // Patch against the running image.
+#define SIM_IMAGE_COMPRESSED        2   // Image packed by LZSS.
+
+#define SIM_SLOT_WRITE_NONE         0
+#define SIM_SLOT_WRITE_INVALIDATED  1   // Header cleared first, as manage_fwu_eeprom.py does.
+#define SIM_SLOT_WRITE_STALE_HEADER 2   // Header left in place by the writer.
+
+
+typedef struct
+{
+    const char *name;
+    uint16_t    running_length;             // Image in the flash at power on.
+    uint16_t    update_length;              // Image in the update slot, 0 for none.
+    uint8_t     backup;
+    bool        update_confirms;            // Updated application stops the watchdog and resets the config.
+    bool        expect_update;              // Flash holds the slot 1 image at the end.
+    bool        serial_ingest;              // Update is sent over the UART instead of stored in slot 1.
+    bool        application_staging;        // Running application stores the update through the boot services.
+    uint8_t     mirror_slot;                // Slot an earlier A/B update left the running image in, 0 for none.
+    uint8_t     changed_pages;              // Update differs from the running image in its first pages only, 0 for all.
+    bool        blank_gap;                  // Middle half of the update is blank, stored with an occupancy map.
+    bool        fast_boot_hint;             // An earlier boot left the fast boot hint set.
+    uint8_t     first_reset;                // SIM_RESET_* of the first boot.
+    uint8_t     image_format;               // SIM_IMAGE_* of the update in the slot.
+    bool        second_update;              // A raw update which does not confirm follows the confirmed one.
+    uint16_t    power_loss_erases;          // Page erases of the first boot before the power fails, 0 for none.
+    uint8_t     slot_2_write;               // SIM_SLOT_WRITE_* of a host write to slot 2 cut short over its backup.
+} sim_scenario_t;
+
+
+/*
+Called after every boot of a scenario, sim_stats and the phase marks hold
+the counters of the boot.
+*/
+
+typedef void (*sim_boot_report_t)(const sim_scenario_t *scenario, uint8_t boot, uint8_t result);
+
+
+/**
+  Run one scenario from power on until the application keeps running.
+
+  @param[in]        scenario              Scenario to run.
+  @param[in]        report                Called after every boot.
+
+  @retval           true                  Flash holds the expected image.
+  @retval           false                 Unexpected flash content or access violations.
+
+**/
+bool sim_run_scenario(const sim_scenario_t *scenario, sim_boot_report_t report);
+
+#endif //SIM_SCENARIO_H
@@ -0,0 +1,187 @@
+/**
+  @file
+  iBootLoader - sim/sim_uart_host.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <string.h>
+
+#include <avr/io.h>
+
+#include "sim_mcu.h"
+#include "sim_image.h"
+#include "sim_uart_host.h"
+#include "serial_ingest.h"
+#include "crc_lite.h"
+
+
+#define SIM_UART_HOST_FRAME_CYCLES  (10ULL * 8 * (SERIAL_INGEST_UBRR + 1))
+#define SIM_UART_HOST_LATENCY       SIM_US(1000)    // USB full speed frame.
+#define SIM_UART_HOST_HELLO_PERIOD  SIM_US(2000)
+#define SIM_UART_HOST_HELLO_COUNT   200
+#define SIM_UART_HOST_FRAME_SIZE    (4 + SIM_PAGE_SIZE + 4)
+
+
+static const uint8_t *host_image;
+static uint16_t       host_page_count;
+static uint16_t       host_frame_index;     // 0 hello, then the pages, then the end frame.
+static uint8_t        host_reply[3];
+static uint8_t        host_reply_count;
+static bool           host_done;
+
+
+/**
+  Build the frame of host_frame_index.
+
+  @param[out]       frame                 Buffer of SIM_UART_HOST_FRAME_SIZE bytes.
+
+  @retval           uint16_t              Frame size.
+
+**/
+static uint16_t build_host_frame(uint8_t *frame)
+{
+    image_header_t image_header;
+    uint32_t checksum;
+    uint8_t length = 0;
+
+    frame[0] = SERIAL_INGEST_SYNC;
+    frame[2] = 0;
+
+    if (host_frame_index == 0)
+    {
+        frame[1] = SERIAL_INGEST_FRAME_HELLO;
+    }
+    else if (host_frame_index <= host_page_count)
+    {
+        frame[1] = SERIAL_INGEST_FRAME_PAGE;
+        frame[2] = host_frame_index - 1;
+        length   = SIM_PAGE_SIZE;
+        memcpy(&frame[4], &host_image[(host_frame_index - 1) * SIM_PAGE_SIZE], length);
+    }
+    else
+    {
+        frame[1] = SERIAL_INGEST_FRAME_END;
+        length   = sizeof(image_header);
+        sim_make_image_header(&image_header, host_image, host_page_count * SIM_PAGE_SIZE);
+        memcpy(&frame[4], &image_header, length);
+    }
+
+    frame[3] = length;
+    checksum = crc_lite_update(0, &frame[1], 3 + length);
+    memcpy(&frame[4 + length], &checksum, sizeof(checksum));
+
+    return 4 + length + sizeof(checksum);
+}
+
+
+/**
+  Take a byte sent by the bootloader. Every answer is three bytes; an answer
+  to the current frame moves on to the next frame or repeats the current one.
+
+  @param[in]        value                 Byte sent by the bootloader.
+  @param[in]        frame_cycles          Frame time of the bootloader baud rate.
+
+**/
+static void take_host_reply(uint8_t value, uint64_t frame_cycles)
+{
+    uint8_t frame[SIM_UART_HOST_FRAME_SIZE];
+    uint16_t size;
+
+    // Log output at the boot baud rate is not for the sender.
+    if (frame_cycles != SIM_UART_HOST_FRAME_CYCLES || host_done)
+        return;
+
+    host_reply[host_reply_count++] = value;
+    if (host_reply_count < sizeof(host_reply))
+        return;
+    host_reply_count = 0;
+
+    // A NAK may answer a frame the bootloader could not parse, repeat on any of them.
+    size = build_host_frame(frame);
+    if (host_reply[0] != SERIAL_INGEST_NAK && (host_reply[1] != frame[1] || host_reply[2] != frame[2]))
+        return;
+
+    if (host_reply[0] == SERIAL_INGEST_ACK)
+    {
+        if (host_frame_index == host_page_count + 1)
+        {
+            host_done = true;
+            return;
+        }
+
+        host_frame_index++;
+        size = build_host_frame(frame);
+    }
+
+    sim_uart_cancel();
+    sim_uart_send(frame, size, sim_cycles + SIM_UART_HOST_FRAME_CYCLES + SIM_UART_HOST_LATENCY,
+                  SIM_UART_HOST_FRAME_CYCLES);
+}
+
+
+/**
+  Start sending an image to the serial ingest of the bootloader, as
+  send_fwu_serial.py does: hello frames every few milliseconds until one is
+  answered, then one frame per page and the end frame with the image header.
+  The host answers the bootloader after a USB round trip.
+
+  @param[in]        image                 Image data, kept until the transfer is done.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_uart_host_start(const uint8_t *image, uint16_t length)
+{
+    uint8_t frame[SIM_UART_HOST_FRAME_SIZE];
+    uint16_t size;
+
+    host_image       = image;
+    host_page_count  = length / SIM_PAGE_SIZE;
+    host_frame_index = 0;
+    host_reply_count = 0;
+    host_done        = false;
+
+    size = build_host_frame(frame);
+    for(uint16_t i = 0; i < SIM_UART_HOST_HELLO_COUNT; i++)
+        sim_uart_send(frame, size, sim_cycles + i * SIM_UART_HOST_HELLO_PERIOD, SIM_UART_HOST_FRAME_CYCLES);
+
+    sim_uart_transmit_hook = take_host_reply;
+}
+
+
+/**
+  Stop the sender.
+
+  @retval           true                  End frame was acknowledged.
+  @retval           false                 Transfer did not complete.
+
+**/
+bool sim_uart_host_stop()
+{
+    sim_uart_transmit_hook = NULL;
+    sim_uart_cancel();
+
+    return host_done;
+}
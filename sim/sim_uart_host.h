@@ -0,0 +1,58 @@
+/**
+  @file
+  iBootLoader - sim/sim_uart_host.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SIM_UART_HOST_H
+#define SIM_UART_HOST_H
+
+#include <stdint.h>
+
+
+/**
+  Start sending an image to the serial ingest of the bootloader, as
+  send_fwu_serial.py does: hello frames every few milliseconds until one is
+  answered, then one frame per page and the end frame with the image header.
+  The host answers the bootloader after a USB round trip.
+
+  @param[in]        image                 Image data, kept until the transfer is done.
+  @param[in]        length                Image length, a multiple of the page size.
+
+**/
+void sim_uart_host_start(const uint8_t *image, uint16_t length);
+
+
+/**
+  Stop the sender.
+
+  @retval           true                  End frame was acknowledged.
+  @retval           false                 Transfer did not complete.
+
+**/
+bool sim_uart_host_stop();
+
+#endif //SIM_UART_HOST_H
@@ -0,0 +1,194 @@
+/**
+  @file
+  iBootLoader - boot_services.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef BOOT_SERVICES_H
+#define BOOT_SERVICES_H
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "image_header.h"
+
+#ifndef BOOT_SERVICES_ENABLE
+#define BOOT_SERVICES_ENABLE 0
+#endif
+
+// Last 16 bytes of the bootloader section, set by --section-start=.boot_services in src/Makefile.
+#ifndef BOOT_SERVICES_ADDRESS
+#define BOOT_SERVICES_ADDRESS    (FLASHEND - 15)
+#endif
+
+#define BOOT_SERVICES_MAGIC      0x5362  // "bS"
+#define BOOT_SERVICES_VERSION    2
+
+#define BOOT_SERVICES_SECTION    __attribute__((used, section(".boot_services")))
+
+
+/*
+  Services the bootloader exports to the application, so an application which
+  receives firmware over its own link can stage it in slot 1 with the drivers
+  of the bootloader instead of its own.
+
+  The application finds the table at BOOT_SERVICES_ADDRESS in the flash and
+  calls the entries through the functions below. A service blocks until the
+  EEPROM is done, up to one write cycle per page, and uses up to 200 bytes of
+  the application stack. It takes the I2C bus for the call: the TWI registers
+  are put back afterwards, but no TWI transfer of the application may be
+  running. The bootloader keeps no state between calls. Services return
+  RETURN_CODE_SUCCESS (0) or RETURN_CODE_FAILURE (1).
+
+  A new version only appends entries, an application checks the version for
+  the entries it needs.
+*/
+
+typedef struct
+{
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  reserved;
+
+    // Write one SPM_PAGESIZE page of slot 1. Writing page 0 invalidates the image header of the slot.
+    uint8_t (*write_slot_page)(uint8_t page_number, const uint8_t *page_buffer);
+
+    // CRC-32 of the first length bytes of slot 1, as the image header carries it.
+    uint8_t (*get_slot_checksum)(uint16_t length, uint32_t *checksum);
+
+    // Check the slot against the image header, write the header and enable the update at the next reset.
+    uint8_t (*commit_update)(const image_header_t *image_header);
+
+    // Version 2: write the default config, once the new firmware runs.
+    uint8_t (*confirm_update)(void);
+} boot_services_t;
+
+
+// Table of the bootloader build, the application uses get_boot_services().
+extern const boot_services_t boot_services;
+
+
+/**
+  Find the service table of the bootloader.
+
+  @retval           NULL                  Bootloader exports no services.
+  @retval           boot_services_t*      Service table in the flash.
+
+**/
+static inline const boot_services_t *get_boot_services()
+{
+    const boot_services_t *services = (const boot_services_t *)BOOT_SERVICES_ADDRESS;
+
+    if (pgm_read_word(&services->magic) != BOOT_SERVICES_MAGIC ||
+        pgm_read_byte(&services->version) < BOOT_SERVICES_VERSION)
+        return NULL;
+
+    return services;
+}
+
+
+/**
+  Write one page of slot 1.
+
+  @param[in]        boot_services         Table from get_boot_services().
+  @param[in]        page_number           Page of the slot.
+  @param[in]        page_buffer           SPM_PAGESIZE bytes of the page.
+
+  @retval           RETURN_CODE_FAILURE   Page outside the slot or write failed.
+  @retval           RETURN_CODE_SUCCESS   Page written.
+
+**/
+static inline uint8_t boot_write_slot_page(const boot_services_t *boot_services, uint8_t page_number,
+                                           const uint8_t *page_buffer)
+{
+    uint8_t (*service)(uint8_t, const uint8_t *) =
+        (uint8_t (*)(uint8_t, const uint8_t *))pgm_read_ptr(&boot_services->write_slot_page);
+
+    return service(page_number, page_buffer);
+}
+
+
+/**
+  Compute the CRC-32 of the start of slot 1.
+
+  @param[in]        boot_services         Table from get_boot_services().
+  @param[in]        length                Number of bytes from the start of the slot.
+  @param[out]       checksum              CRC-32 of the bytes.
+
+  @retval           RETURN_CODE_FAILURE   Length beyond the slot or read failed.
+  @retval           RETURN_CODE_SUCCESS   Checksum computed.
+
+**/
+static inline uint8_t boot_get_slot_checksum(const boot_services_t *boot_services, uint16_t length,
+                                             uint32_t *checksum)
+{
+    uint8_t (*service)(uint16_t, uint32_t *) =
+        (uint8_t (*)(uint16_t, uint32_t *))pgm_read_ptr(&boot_services->get_slot_checksum);
+
+    return service(length, checksum);
+}
+
+
+/**
+  Commit the image in slot 1. The bootloader flashes it at the next reset,
+  with a backup of the running firmware if the config asks for it.
+
+  @param[in]        boot_services         Table from get_boot_services().
+  @param[in]        image_header          Header of the image in slot 1.
+
+  @retval           RETURN_CODE_FAILURE   Slot does not match the header or write failed.
+  @retval           RETURN_CODE_SUCCESS   Update enabled.
+
+**/
+static inline uint8_t boot_commit_update(const boot_services_t *boot_services, const image_header_t *image_header)
+{
+    uint8_t (*service)(const image_header_t *) =
+        (uint8_t (*)(const image_header_t *))pgm_read_ptr(&boot_services->commit_update);
+
+    return service(image_header);
+}
+
+
+/**
+  Confirm the running firmware, so no rollback follows the next reset. The
+  config goes into the config ring when the bootloader has one. Confirming
+  at every start writes only once. The watchdog is left to the
+  application.
+
+  @param[in]        boot_services         Table from get_boot_services().
+
+  @retval           RETURN_CODE_FAILURE   Config read or write failed.
+  @retval           RETURN_CODE_SUCCESS   Firmware confirmed.
+
+**/
+static inline uint8_t boot_confirm_update(const boot_services_t *boot_services)
+{
+    uint8_t (*service)(void) = (uint8_t (*)(void))pgm_read_ptr(&boot_services->confirm_update);
+
+    return service();
+}
+
+#endif //BOOT_SERVICES_H
@@ -0,0 +1,94 @@
+/**
+  @file
+  iBootLoader - boot_timing.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <avr/io.h>
+#include <string.h>
+
+#include "boot_timing.h"
+#include "record_ring.h"
+#include "ialoy_code.h"
+
+#if BOOT_TIMING_ENABLE
+
+static boot_timing_record_t timing_record;
+static uint8_t current_phase;
+
+
+/**
+  Start Timer1 and keep the reset flags. Called first in main(), before the
+  watchdog setup clears MCUSR. Phases a boot does not run stay at zero.
+
+**/
+void start_boot_timing()
+{
+    memset(&timing_record, 0, sizeof(timing_record));
+    timing_record.reset_flags = MCUSR;
+    current_phase = 0;
+
+    TCCR1A = 0;
+    TCNT1  = 0;
+    TIFR1  = _BV(TOV1);
+    TCCR1B = BOOT_TIMING_PRESCALER;
+}
+
+
+/**
+  Close the running phase and start the next one. BOOT_PHASE_JUMP appends
+  the timing record to the EEPROM and stops Timer1.
+
+  @param[in]        phase                 BOOT_PHASE_* of the starting phase.
+
+**/
+void mark_boot_phase(uint8_t phase)
+{
+    uint16_t ticks = TCNT1;
+
+    // Every phase restarts the counter, so only a phase of 4.19 s or more overflows.
+    if (TIFR1 & _BV(TOV1))
+        ticks = BOOT_TIMING_OVERFLOW;
+
+    TCNT1 = 0;
+    TIFR1 = _BV(TOV1);
+
+    if (current_phase < BOOT_PHASE_JUMP)
+        timing_record.ticks[current_phase] = ticks;
+    current_phase = phase;
+
+    if (phase != BOOT_PHASE_JUMP)
+        return;
+
+    append_ring_record(BOOT_TIMING_PAGE_NUMBER, BOOT_TIMING_PAGE_COUNT, &timing_record, sizeof(timing_record));
+
+    // Leave Timer1 in its reset state for the application.
+    TCCR1B = 0;
+    TCNT1  = 0;
+    TIFR1  = _BV(TOV1);
+}
+
+#endif
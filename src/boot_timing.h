@@ -0,0 +1,95 @@
+/**
+  @file
+  iBootLoader - boot_timing.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef BOOT_TIMING_H
+#define BOOT_TIMING_H
+
+#include <stdint.h>
+
+#include "ialoy_code.h"
+#include "target_profile.h"
+
+#ifndef BOOT_TIMING_ENABLE
+#define BOOT_TIMING_ENABLE 0
+#endif
+
+// Ring of timing records in the reserved space of the EEPROM (0xF800 with a 24LC512).
+#define BOOT_TIMING_PAGE_NUMBER     EEPROM_RESERVED_PAGE_NUMBER
+#define BOOT_TIMING_PAGE_COUNT      2
+
+// Timer1 runs from F_CPU / 1024, 64 us per tick at 16 MHz.
+#define BOOT_TIMING_PRESCALER       (_BV(CS12) | _BV(CS10))
+#define BOOT_TIMING_OVERFLOW        0xFFFF
+
+
+/*
+Timing of one boot, appended to the timing ring when the bootloader jumps to
+the application. ticks[phase] is the time from the BOOT_PHASE() mark of the
+phase to the next mark, index 0 is the time from reset to BOOT_PHASE_CONFIG.
+Phases not reached are 0, a phase of 4.19 s or more is BOOT_TIMING_OVERFLOW.
+*/
+
+typedef struct
+{
+    uint16_t sequence;
+    uint16_t ticks[BOOT_PHASE_JUMP];
+    uint8_t  reset_flags;                   // MCUSR at reset.
+    uint8_t  check;
+} boot_timing_record_t;
+
+#if BOOT_TIMING_ENABLE
+
+/**
+  Start Timer1 and keep the reset flags. Called first in main(), before the
+  watchdog setup clears MCUSR.
+
+**/
+void start_boot_timing();
+
+
+/**
+  Close the running phase and start the next one. BOOT_PHASE_JUMP appends
+  the timing record to the EEPROM and stops Timer1.
+
+  @param[in]        phase                 BOOT_PHASE_* of the starting phase.
+
+**/
+void mark_boot_phase(uint8_t phase);
+
+#else
+
+/**
+  Start Timer1 and keep the reset flags.
+
+**/
+#define start_boot_timing()
+
+#endif
+
+#endif //BOOT_TIMING_H
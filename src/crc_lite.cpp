@@ -0,0 +1,69 @@
+/**
+  @file
+  iBootLoader - crc_lite.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "crc_lite.h"
+#include "target_profile.h"
+
+
+// CRC-32 of every 4 bit value, the CRC is updated one nibble at a time
+static const uint32_t crc_lite_table[16] PROGMEM =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+
+/**
+  Update a CRC-32 (IEEE 802.3, same as zlib crc32) with a block of data. Start
+  with 0 and feed the result of the previous call to continue a stream.
+
+  @param[in]        crc                   CRC of the data so far.
+  @param[in]        data                  Buffer pointer of the data.
+  @param[in]        length                Amount of data in the buffer.
+
+  @retval           uint32_t              CRC of the data including this block.
+
+**/
+uint32_t crc_lite_update(uint32_t crc, const uint8_t *data, uint16_t length)
+{
+    crc = ~crc;
+
+    for(uint16_t i = 0; i < length; i++)
+    {
+        crc = (crc >> 4) ^ read_flash_dword(crc_lite_table, (crc ^ data[i]) & 0x0F);
+        crc = (crc >> 4) ^ read_flash_dword(crc_lite_table, (crc ^ (data[i] >> 4)) & 0x0F);
+    }
+
+    return ~crc;
+}
@@ -0,0 +1,47 @@
+/**
+  @file
+  iBootLoader - crc_lite.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef CRC_LITE_H
+#define CRC_LITE_H
+
+
+/**
+  Update a CRC-32 (IEEE 802.3, same as zlib crc32) with a block of data. Start
+  with 0 and feed the result of the previous call to continue a stream.
+
+  @param[in]        crc                   CRC of the data so far.
+  @param[in]        data                  Buffer pointer of the data.
+  @param[in]        length                Amount of data in the buffer.
+
+  @retval           uint32_t              CRC of the data including this block.
+
+**/
+uint32_t crc_lite_update(uint32_t crc, const uint8_t *data, uint16_t length);
+
+#endif //CRC_LITE_H
@@ -32,10 +32,23 @@
 #include "eeprom_read_write.h"
 #include "i2c_lite.h"
 #include "ialoy_code.h"
+#include "target_profile.h"
+
+
+// I2C address of the chip and 64 KB block holding an EEPROM byte address.
+#if EEPROM_SIZE > 0x10000
+#define EEPROM_DEVICE(address)  (EEPROM_I2C_ADDRESS | (uint8_t)((address) >> EEPROM_CHIP_SHIFT) | \
+                                 (((address) & 0x10000UL) ? EEPROM_BLOCK_SELECT : 0))
+
+static uint8_t          write_device = EEPROM_I2C_ADDRESS;  // Chip of the last started page write.
+static eeprom_address_t stream_address;                     // Address of the next stream byte.
+#else
+#define EEPROM_DEVICE(address)  EEPROM_I2C_ADDRESS
+#endif
 
 
 /**
-  Initilize EEPROM with default 0x50 i2c address.
+  Initilize EEPROM with default 0x50 i2c address and the i2c bus.
 
 **/
 void init_EEPROM_bus()
@@ -47,6 +60,8 @@ void init_EEPROM_bus()
     SIPO_DATA_PORT  &= ~(_BV(SIPO_DATA_PIN));
     SIPO_CLK_PORT   &= ~(_BV(SIPO_CLK_PIN));
     SIPO_LATCH_PORT |= _BV(SIPO_LATCH_PIN);
+
+    i2c_lite_init();
 }
 
 
@@ -73,36 +88,122 @@ void update_EEPROM_bus(uint8_t state)
 }
 
 
+/**
+  Start a write transfer and send a memory address.
+
+  @param[in]        address               Byte address on the EEPROM.
+
+**/
+static void send_EEPROM_address(eeprom_address_t address)
+{
+    i2c_lite_start();
+    i2c_lite_write((EEPROM_DEVICE(address) << 1) | TW_WRITE);
+    i2c_lite_write((uint8_t)(address >> 8));    // MSB of memory address
+    i2c_lite_write((uint8_t)(address & 0xFF));  // LSB of memory address
+}
+
+
+/**
+  Send data for the page buffer of the EEPROM and start its write cycle. A
+  flash page larger than the EEPROM page is sent in one part per EEPROM page,
+  each after the write cycle of the part before.
+
+  @param[in]        buffer                Buffer pointer of the data.
+  @param[in]        address               Byte address on the EEPROM.
+  @param[in]        size                  Amount of data need to be write.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle of a part did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Last part sent, write cycle running.
+
+**/
+static uint8_t send_EEPROM_data(uint8_t *buffer, eeprom_address_t address, uint16_t size)
+{
+#if SPM_PAGESIZE > EEPROM_PAGE_SIZE
+    uint16_t part = EEPROM_PAGE_SIZE - (address & (EEPROM_PAGE_SIZE - 1));
+
+    while (size > part)
+    {
+        send_EEPROM_address(address);
+        for(uint16_t i = 0; i < part; i++)
+        {
+            i2c_lite_write(buffer[i]);
+        }
+        i2c_lite_stop();
+
+        if (i2c_lite_poll_ack(EEPROM_DEVICE(address)) == RETURN_CODE_FAILURE)
+            return RETURN_CODE_FAILURE;
+
+        buffer  += part;
+        address += part;
+        size    -= part;
+        part     = EEPROM_PAGE_SIZE;
+    }
+#endif
+
+    send_EEPROM_address(address);
+
+    for(uint16_t i = 0; i < size; i++)
+    {
+        i2c_lite_write(buffer[i]);
+    }
+
+    i2c_lite_stop();
+    return RETURN_CODE_SUCCESS;
+}
+
+
 /**
   Read SPM_PAGESIZE data from the EEPROM from a specific address.
 
   @param[in out]    page_buffer           Buffer pointer to get the data.
   @param[in]        page_number           Page Number from where data need to be read.
   @param[in]        page_size             Page size, amount of data need to be read.
+  @param[in]        idle_task             Optional task to run after every received byte.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read data.
+  @retval           RETURN_CODE_SUCCESS   Data read successfully.
+
+**/
+uint8_t read_from_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint16_t page_size,
+                              void (*idle_task)(void))
+{
+    return read_from_EEPROM_page_offset(page_buffer, page_number, 0, page_size, idle_task);
+}
+
+
+/**
+  Read data inside a page of the EEPROM, starting at a byte offset.
+
+  @param[in out]    buffer                Buffer pointer to get the data.
+  @param[in]        page_number           Page Number from where data need to be read.
+  @param[in]        offset                Byte offset inside the page.
+  @param[in]        size                  Amount of data need to be read.
+  @param[in]        idle_task             Optional task to run after every received byte.
 
   @retval           RETURN_CODE_FAILURE   Failed to read data.
   @retval           RETURN_CODE_SUCCESS   Data read successfully.
 
 **/
-uint8_t read_from_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint8_t page_size)
+uint8_t read_from_EEPROM_page_offset(uint8_t *buffer, uint16_t page_number, uint8_t offset, uint16_t size,
+                                     void (*idle_task)(void))
 {
     uint8_t status = RETURN_CODE_FAILURE;
-    i2c_lite_init();
+    eeprom_address_t address = (eeprom_address_t)page_number * SPM_PAGESIZE + offset;
 
-    i2c_lite_start();
-    i2c_lite_write((EEPROM_I2C_ADDRESS << 1) | TW_WRITE);
-    i2c_lite_write((uint8_t)((page_number * SPM_PAGESIZE) >> 8));    // MSB of memory address
-    i2c_lite_write((uint8_t)((page_number * SPM_PAGESIZE) & 0xFF));  // LSB of memory address
+    send_EEPROM_address(address);
     i2c_lite_stop();
 
     i2c_lite_start();
-    i2c_lite_write((EEPROM_I2C_ADDRESS << 1) | TW_READ);
+    i2c_lite_write((EEPROM_DEVICE(address) << 1) | TW_READ);
 
-    for(uint8_t i = 0; i < page_size; i++)
+    for(uint16_t i = 0; i < size; i++)
     {
-        status = i2c_lite_read(&page_buffer[i], i < page_size - 1);
+        status = i2c_lite_read(&buffer[i], i < size - 1);
         if (status == RETURN_CODE_FAILURE)
             return RETURN_CODE_FAILURE;
+
+        if (idle_task)
+            idle_task();
     }
 
     i2c_lite_stop();
@@ -116,21 +217,164 @@ uint8_t read_from_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint8_
   @param[in out]    page_buffer           Buffer pointer of the data.
   @param[in]        page_number           Page Number where data need to be write.
   @param[in]        page_size             Page size, amount of data need to be write.
+  @param[out]       poll_count            Optional, ACK polls until the write cycle ended.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Data written successfully.
 
 **/
-void write_to_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint8_t page_size)
+uint8_t write_to_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint16_t page_size,
+                             uint16_t *poll_count)
 {
-    i2c_lite_init();
+    return write_to_EEPROM_page_offset(page_buffer, page_number, 0, page_size, poll_count);
+}
+
+
+/**
+  Write data inside a page of the EEPROM, starting at a byte offset. The
+  data must not cross the end of the page.
+
+  @param[in out]    buffer                Buffer pointer of the data.
+  @param[in]        page_number           Page Number where data need to be write.
+  @param[in]        offset                Byte offset inside the page.
+  @param[in]        size                  Amount of data need to be write.
+  @param[out]       poll_count            Optional, ACK polls until the write cycle ended.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Data written successfully.
+
+**/
+uint8_t write_to_EEPROM_page_offset(uint8_t *buffer, uint16_t page_number, uint8_t offset, uint16_t size,
+                                    uint16_t *poll_count)
+{
+    eeprom_address_t address = (eeprom_address_t)page_number * SPM_PAGESIZE + offset;
+
+    if (send_EEPROM_data(buffer, address, size) == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+    return i2c_lite_poll_ack(EEPROM_DEVICE(address), poll_count);
+}
+
+
+/**
+  Start a page write without waiting for the write cycle, so the caller can
+  prepare the next page meanwhile. The write cycle of a previous start is
+  waited for first, wait_EEPROM_page_write() ends the last one.
+
+  @param[in]        page_buffer           Buffer pointer of the data.
+  @param[in]        page_number           Page Number where data need to be write.
+  @param[in]        page_size             Page size, amount of data need to be write.
+
+  @retval           RETURN_CODE_FAILURE   Previous write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Page sent, write cycle running.
+
+**/
+uint8_t start_EEPROM_page_write(uint8_t *page_buffer, uint16_t page_number, uint16_t page_size)
+{
+    eeprom_address_t address = (eeprom_address_t)page_number * SPM_PAGESIZE;
+
+    if (wait_EEPROM_page_write() == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+#if EEPROM_SIZE > 0x10000
+    write_device = EEPROM_DEVICE(address);
+#endif
+
+    return send_EEPROM_data(page_buffer, address, page_size);
+}
+
+
+/**
+  Wait for the end of the write cycle started by start_EEPROM_page_write().
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   EEPROM is ready.
+
+**/
+uint8_t wait_EEPROM_page_write()
+{
+#if EEPROM_SIZE > 0x10000
+    return i2c_lite_poll_ack(write_device);
+#else
+    return i2c_lite_poll_ack(EEPROM_I2C_ADDRESS);
+#endif
+}
+
+
+/**
+  Open a sequential read stream at the start of a page. The EEPROM keeps
+  incrementing its address, so any number of pages can be read back to back
+  without sending the address again.
+
+  @param[in]        page_number           Page Number where the stream starts.
+
+  @retval           RETURN_CODE_FAILURE   EEPROM did not respond.
+  @retval           RETURN_CODE_SUCCESS   Stream opened successfully.
+
+**/
+uint8_t open_EEPROM_stream(uint16_t page_number)
+{
+    eeprom_address_t address = (eeprom_address_t)page_number * SPM_PAGESIZE;
+
+#if EEPROM_SIZE > 0x10000
+    stream_address = address;
+#endif
+
+    send_EEPROM_address(address);
 
     i2c_lite_start();
-    i2c_lite_write((EEPROM_I2C_ADDRESS << 1) | TW_WRITE);
-    i2c_lite_write((uint8_t)((page_number * SPM_PAGESIZE) >> 8));    // MSB of memory address
-    i2c_lite_write((uint8_t)((page_number * SPM_PAGESIZE) & 0xFF));  // LSB of memory address
+    i2c_lite_write((EEPROM_DEVICE(address) << 1) | TW_READ);
 
-    for(uint8_t i = 0; i < page_size; i++)
+    return (TW_STATUS == TW_MR_SLA_ACK) ? RETURN_CODE_SUCCESS : RETURN_CODE_FAILURE;
+}
+
+
+/**
+  Read the next bytes of an open read stream.
+
+  @param[in out]    buffer                Buffer pointer to get the data.
+  @param[in]        length                Amount of data need to be read.
+  @param[in]        idle_task             Optional task to run after every received byte.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read data.
+  @retval           RETURN_CODE_SUCCESS   Data read successfully.
+
+**/
+uint8_t read_EEPROM_stream(uint8_t *buffer, uint16_t length, void (*idle_task)(void))
+{
+    for(uint16_t i = 0; i < length; i++)
     {
-        i2c_lite_write(page_buffer[i]);
+        if (i2c_lite_read(&buffer[i], true) == RETURN_CODE_FAILURE)
+            return RETURN_CODE_FAILURE;
+
+#if EEPROM_SIZE > 0x10000
+        // The address counter wraps inside a 64 KB block, the stream goes on
+        // at the start of the next block or chip.
+        if ((uint16_t)++stream_address == 0)
+        {
+            close_EEPROM_stream();
+            if (open_EEPROM_stream(stream_address / SPM_PAGESIZE) == RETURN_CODE_FAILURE)
+                return RETURN_CODE_FAILURE;
+        }
+#endif
+
+        if (idle_task)
+            idle_task();
     }
 
+    return RETURN_CODE_SUCCESS;
+}
+
+
+/**
+  Close an open read stream. One more byte is read and not acknowledged, so
+  the EEPROM releases the bus before the STOP.
+
+**/
+void close_EEPROM_stream()
+{
+    uint8_t data;
+
+    i2c_lite_read(&data, false);
     i2c_lite_stop();
 }
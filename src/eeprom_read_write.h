@@ -30,9 +30,12 @@
 #ifndef EEPROM_READ_WRITE_H
 #define EEPROM_READ_WRITE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 
 /**
-  Initilize EEPROM with default 0x50 i2c address.
+  Initilize EEPROM with default 0x50 i2c address and the i2c bus.
 
 **/
 void init_EEPROM_bus();
@@ -53,12 +56,31 @@ void update_EEPROM_bus(uint8_t status);
   @param[in out]    page_buffer           Buffer pointer to get the data.
   @param[in]        page_number           Page Number from where data need to be read.
   @param[in]        page_size             Page size, amount of data need to be read.
+  @param[in]        idle_task             Optional task to run after every received byte.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read data.
+  @retval           RETURN_CODE_SUCCESS   Data read successfully.
+
+**/
+uint8_t read_from_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint16_t page_size,
+                              void (*idle_task)(void) = NULL);
+
+
+/**
+  Read data inside a page of the EEPROM, starting at a byte offset.
+
+  @param[in out]    buffer                Buffer pointer to get the data.
+  @param[in]        page_number           Page Number from where data need to be read.
+  @param[in]        offset                Byte offset inside the page.
+  @param[in]        size                  Amount of data need to be read.
+  @param[in]        idle_task             Optional task to run after every received byte.
 
   @retval           RETURN_CODE_FAILURE   Failed to read data.
   @retval           RETURN_CODE_SUCCESS   Data read successfully.
 
 **/
-uint8_t read_from_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint8_t page_size);
+uint8_t read_from_EEPROM_page_offset(uint8_t *buffer, uint16_t page_number, uint8_t offset, uint16_t size,
+                                     void (*idle_task)(void) = NULL);
 
 
 /**
@@ -67,8 +89,93 @@ uint8_t read_from_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint8_
   @param[in out]    page_buffer           Buffer pointer of the data.
   @param[in]        page_number           Page Number where data need to be write.
   @param[in]        page_size             Page size, amount of data need to be write.
+  @param[out]       poll_count            Optional, ACK polls until the write cycle ended.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Data written successfully.
+
+**/
+uint8_t write_to_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint16_t page_size,
+                             uint16_t *poll_count = NULL);
+
+
+/**
+  Write data inside a page of the EEPROM, starting at a byte offset. The
+  data must not cross the end of the page.
+
+  @param[in out]    buffer                Buffer pointer of the data.
+  @param[in]        page_number           Page Number where data need to be write.
+  @param[in]        offset                Byte offset inside the page.
+  @param[in]        size                  Amount of data need to be write.
+  @param[out]       poll_count            Optional, ACK polls until the write cycle ended.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Data written successfully.
+
+**/
+uint8_t write_to_EEPROM_page_offset(uint8_t *buffer, uint16_t page_number, uint8_t offset, uint16_t size,
+                                    uint16_t *poll_count = NULL);
+
+
+/**
+  Start a page write without waiting for the write cycle, so the caller can
+  prepare the next page meanwhile. The write cycle of a previous start is
+  waited for first, wait_EEPROM_page_write() ends the last one.
+
+  @param[in]        page_buffer           Buffer pointer of the data.
+  @param[in]        page_number           Page Number where data need to be write.
+  @param[in]        page_size             Page size, amount of data need to be write.
+
+  @retval           RETURN_CODE_FAILURE   Previous write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Page sent, write cycle running.
+
+**/
+uint8_t start_EEPROM_page_write(uint8_t *page_buffer, uint16_t page_number, uint16_t page_size);
+
+
+/**
+  Wait for the end of the write cycle started by start_EEPROM_page_write().
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   EEPROM is ready.
+
+**/
+uint8_t wait_EEPROM_page_write();
+
+
+/**
+  Open a sequential read stream at the start of a page. The EEPROM keeps
+  incrementing its address, so any number of pages can be read back to back
+  without sending the address again.
+
+  @param[in]        page_number           Page Number where the stream starts.
+
+  @retval           RETURN_CODE_FAILURE   EEPROM did not respond.
+  @retval           RETURN_CODE_SUCCESS   Stream opened successfully.
+
+**/
+uint8_t open_EEPROM_stream(uint16_t page_number);
+
+
+/**
+  Read the next bytes of an open read stream.
+
+  @param[in out]    buffer                Buffer pointer to get the data.
+  @param[in]        length                Amount of data need to be read.
+  @param[in]        idle_task             Optional task to run after every received byte.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read data.
+  @retval           RETURN_CODE_SUCCESS   Data read successfully.
+
+**/
+uint8_t read_EEPROM_stream(uint8_t *buffer, uint16_t length, void (*idle_task)(void) = NULL);
+
+
+/**
+  Close an open read stream. One more byte is read and not acknowledged, so
+  the EEPROM releases the bus before the STOP.
 
 **/
-void write_to_EEPROM_page(uint8_t *page_buffer, uint16_t page_number, uint8_t page_size);
+void close_EEPROM_stream();
 
 #endif //EEPROM_READ_WRITE_H
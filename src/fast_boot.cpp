@@ -0,0 +1,167 @@
+/**
+  @file
+  iBootLoader - fast_boot.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <stddef.h>
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+#include "fast_boot.h"
+
+#if FAST_BOOT_ENABLE
+
+/**
+  Read a hint byte from the internal EEPROM.
+
+  @param[in]        address               Internal EEPROM address.
+
+  @retval           uint8_t               Hint byte.
+
+**/
+static uint8_t read_fast_boot_byte(uint16_t address)
+{
+    while (EECR & _BV(EEPE));
+
+    EEAR = address;
+    EECR |= _BV(EERE);
+    return EEDR;
+}
+
+
+/**
+  Write a hint byte to the internal EEPROM, unless it already holds the
+  value. The write cycle of 3.4 ms runs on after the return, the next access
+  waits for it.
+
+  @param[in]        address               Internal EEPROM address.
+  @param[in]        value                 Hint byte.
+
+**/
+static void write_fast_boot_byte(uint16_t address, uint8_t value)
+{
+    if (read_fast_boot_byte(address) == value)
+        return;
+
+    EEDR = value;
+
+    // EEPE has to follow EEMPE within four cycles.
+    cli();
+    EECR |= _BV(EEMPE);
+    EECR |= _BV(EEPE);
+    sei();
+}
+
+
+/**
+  Compute the check byte of a hint.
+
+  @param[in]        hint                  Hint to check.
+
+  @retval           uint8_t               Check byte of the hint.
+
+**/
+static uint8_t get_fast_boot_hint_check(const fast_boot_hint_t *hint)
+{
+    uint8_t check = FAST_BOOT_HINT_KEY;
+
+    for(uint8_t index = 0; index < offsetof(fast_boot_hint_t, check); index++)
+        check ^= ((const uint8_t *)hint)[index];
+
+    return check;
+}
+
+
+/**
+  Read the hint from the internal EEPROM.
+
+  @param[out]       hint                  Buffer for the hint.
+
+**/
+static void read_fast_boot_hint(fast_boot_hint_t *hint)
+{
+    for(uint8_t index = 0; index < sizeof(fast_boot_hint_t); index++)
+        ((uint8_t *)hint)[index] = read_fast_boot_byte(FAST_BOOT_HINT_ADDRESS + index);
+}
+
+
+/**
+  Check whether the boot may go straight to the application. Only a power-on
+  reset with a valid hint qualifies.
+
+  @param[out]       hint                  Buffer for the hint.
+
+  @retval           true                  Hint valid, check the config ring record.
+  @retval           false                 Take the normal boot.
+
+**/
+uint8_t is_fast_boot_allowed(fast_boot_hint_t *hint)
+{
+    if ((MCUSR & (_BV(PORF) | _BV(EXTRF) | _BV(WDRF))) != _BV(PORF))
+        return false;
+
+    read_fast_boot_hint(hint);
+    return hint->check == get_fast_boot_hint_check(hint);
+}
+
+
+/**
+  Set the hint once a full boot found no update pending. The check byte is
+  written last, so a torn write leaves the bytes before it without a match.
+
+  @param[in]        next_record           Config ring index of the next config record.
+  @param[in]        next_sequence         Sequence number it gets.
+
+**/
+void set_fast_boot_hint(uint8_t next_record, uint16_t next_sequence)
+{
+    fast_boot_hint_t hint;
+
+    hint.next_record   = next_record;
+    hint.next_sequence = next_sequence;
+    hint.check         = get_fast_boot_hint_check(&hint);
+
+    for(uint8_t index = 0; index < sizeof(fast_boot_hint_t); index++)
+        write_fast_boot_byte(FAST_BOOT_HINT_ADDRESS + index, ((uint8_t *)&hint)[index]);
+}
+
+
+/**
+  Clear the hint before an update is armed or applied. Only the check byte is
+  written, inverted it can not match.
+
+**/
+void clear_fast_boot_hint()
+{
+    fast_boot_hint_t hint;
+
+    read_fast_boot_hint(&hint);
+    write_fast_boot_byte(FAST_BOOT_HINT_ADDRESS + offsetof(fast_boot_hint_t, check),
+                         ~get_fast_boot_hint_check(&hint));
+}
+
+#endif
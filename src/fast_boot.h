@@ -0,0 +1,108 @@
+/**
+  @file
+  iBootLoader - fast_boot.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef FAST_BOOT_H
+#define FAST_BOOT_H
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#ifndef FAST_BOOT_ENABLE
+#define FAST_BOOT_ENABLE 0
+#endif
+
+/*
+The hint takes over the last four bytes of the internal EEPROM, applications
+keep their own data below FAST_BOOT_HINT_ADDRESS or move the hint with it. It
+names the config ring record the next config is written to; a power-on finds
+a config armed since, e.g. by manage_fwu_eeprom.py over the I2C bus, by
+reading that one record.
+*/
+#ifndef FAST_BOOT_HINT_ADDRESS
+#define FAST_BOOT_HINT_ADDRESS      (E2END - 3)
+#endif
+
+// Mixed into the check byte, so the erased 0xFF hint does not match.
+#define FAST_BOOT_HINT_KEY          0xA5
+
+typedef struct
+{
+    uint16_t next_sequence;                 // Sequence number of the next config record.
+    uint8_t  next_record;                   // Config ring index it is written to.
+    uint8_t  check;                         // XOR of the bytes before and FAST_BOOT_HINT_KEY.
+} fast_boot_hint_t;
+
+#if FAST_BOOT_ENABLE
+
+/**
+  Check whether the boot may go straight to the application. Only a power-on
+  reset with a valid hint qualifies; an external reset and a watchdog reset,
+  which may start a rollback, always read the config. The caller still checks
+  the config ring record named by the hint. Called first in main(), before
+  the watchdog setup clears MCUSR.
+
+  @param[out]       hint                  Buffer for the hint.
+
+  @retval           true                  Hint valid, check the config ring record.
+  @retval           false                 Take the normal boot.
+
+**/
+uint8_t is_fast_boot_allowed(fast_boot_hint_t *hint);
+
+
+/**
+  Set the hint once a full boot found no update pending. The internal EEPROM
+  is written only where the hint changes.
+
+  @param[in]        next_record           Config ring index of the next config record.
+  @param[in]        next_sequence         Sequence number it gets.
+
+**/
+void set_fast_boot_hint(uint8_t next_record, uint16_t next_sequence);
+
+
+/**
+  Clear the hint before an update is armed or applied, so the next boot reads
+  the config whatever its reset cause.
+
+**/
+void clear_fast_boot_hint();
+
+#else
+
+/**
+  Keep the hint, no fast boot in this build.
+
+**/
+#define set_fast_boot_hint(next_record, next_sequence)
+#define clear_fast_boot_hint()
+
+#endif
+
+#endif //FAST_BOOT_H
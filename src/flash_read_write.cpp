@@ -32,31 +32,100 @@
 #include <avr/pgmspace.h>
 
 #include "flash_read_write.h"
+#include "serial_lite.h"
+#include "target_profile.h"
+
+
+#define FLASH_WRITE_IDLE      0
+#define FLASH_WRITE_ERASING   1
+#define FLASH_WRITE_WRITING   2
+
+static uint8_t  flash_write_state = FLASH_WRITE_IDLE;
+static flash_address_t flash_write_address;
 
 
 /**
-  Write SPM_PAGESIZE data to the specific address of Flash Memory.
+  Start writing SPM_PAGESIZE data to the specific address of Flash Memory.
+  The data is loaded into the SPM temporary page buffer and the page erase
+  is issued without waiting, so the caller is free to use page_buffer again
+  while the RWW section is busy. A page of all 0xFF is left blank by the
+  erase, so its page write is not issued.
 
-  @param[in out]    page_buffer           Buffer pointer of the data.
+  @param[in]        page_buffer           Buffer pointer of the data.
   @param[in]        page_number           Page Number where data need to be write.
 
 **/
-void write_to_flash_memory_page(const uint8_t *page_buffer, uint16_t page_number)
+void start_flash_memory_page_write(const uint8_t *page_buffer, uint16_t page_number)
 {
     uint16_t data;
+    uint16_t blank = 0xFFFF;
 
-    boot_page_erase(page_number * SPM_PAGESIZE);
-    boot_spm_busy_wait();
+    wait_flash_memory_page_write();
+    flash_write_address = (flash_address_t)page_number * SPM_PAGESIZE;
 
     for(uint16_t i = 0; i < SPM_PAGESIZE; i += 2)
     {
         data = page_buffer[i] | (page_buffer[i + 1] << 8);
-        boot_page_fill(page_number * SPM_PAGESIZE + i, data);
+        blank &= data;
+        boot_page_fill(flash_write_address + i, data);
+    }
+
+    boot_page_erase(flash_write_address);
+    // A blank page only waits for the erase before the RWW section is re-enabled.
+    flash_write_state = (blank == 0xFFFF) ? FLASH_WRITE_WRITING : FLASH_WRITE_ERASING;
+}
+
+
+/**
+  Move the pending page write one step forward without blocking. Issues the
+  page write once the erase is over and re-enables the RWW section once the
+  write is over.
+
+**/
+void service_flash_memory_page_write()
+{
+    if(flash_write_state == FLASH_WRITE_IDLE || boot_spm_busy())
+        return;
+
+    if(flash_write_state == FLASH_WRITE_ERASING)
+    {
+        boot_page_write(flash_write_address);
+        flash_write_state = FLASH_WRITE_WRITING;
     }
+    else
+    {
+        boot_rww_enable();
+        flash_write_state = FLASH_WRITE_IDLE;
+    }
+}
 
-    boot_page_write(page_number * SPM_PAGESIZE);
-    boot_spm_busy_wait();
-    boot_rww_enable();
+
+/**
+  Wait until the pending page write is completed and the RWW section is
+  readable again.
+
+**/
+void wait_flash_memory_page_write()
+{
+    while(flash_write_state != FLASH_WRITE_IDLE)
+    {
+        service_flash_memory_page_write();
+        service_serial_output();
+    }
+}
+
+
+/**
+  Write SPM_PAGESIZE data to the specific address of Flash Memory.
+
+  @param[in out]    page_buffer           Buffer pointer of the data.
+  @param[in]        page_number           Page Number where data need to be write.
+
+**/
+void write_to_flash_memory_page(const uint8_t *page_buffer, uint16_t page_number)
+{
+    start_flash_memory_page_write(page_buffer, page_number);
+    wait_flash_memory_page_write();
 }
 
 
@@ -69,10 +138,57 @@ void write_to_flash_memory_page(const uint8_t *page_buffer, uint16_t page_number
 **/
 void read_from_flash_memory_page(uint8_t *page_buffer, uint16_t page_number)
 {
-    uint32_t address = page_number * SPM_PAGESIZE;
+    flash_address_t address = (flash_address_t)page_number * SPM_PAGESIZE;
 
     for(uint16_t i = 0; i < SPM_PAGESIZE; i++)
     {
-        page_buffer[i] = pgm_read_byte(address + i);
+        page_buffer[i] = read_flash_byte(address + i);
     }
 }
+
+
+/**
+  Compare SPM_PAGESIZE data with the specific page of Flash Memory.
+
+  @param[in]        page_buffer           Buffer pointer of the data.
+  @param[in]        page_number           Page Number which need to be compared.
+
+  @retval           true                  Flash page holds the same data.
+  @retval           false                 Flash page differs.
+
+**/
+uint8_t is_flash_memory_page_equal(const uint8_t *page_buffer, uint16_t page_number)
+{
+    flash_address_t address = (flash_address_t)page_number * SPM_PAGESIZE;
+
+    for(uint16_t i = 0; i < SPM_PAGESIZE; i++)
+    {
+        if (page_buffer[i] != read_flash_byte(address + i))
+            return false;
+    }
+
+    return true;
+}
+
+
+/**
+  Check whether a page of Flash Memory is erased, all bytes 0xFF.
+
+  @param[in]        page_number           Page Number which need to be checked.
+
+  @retval           true                  Flash page is blank.
+  @retval           false                 Flash page holds data.
+
+**/
+uint8_t is_flash_memory_page_blank(uint16_t page_number)
+{
+    flash_address_t address = (flash_address_t)page_number * SPM_PAGESIZE;
+
+    for(uint16_t i = 0; i < SPM_PAGESIZE; i++)
+    {
+        if (read_flash_byte(address + i) != 0xFF)
+            return false;
+    }
+
+    return true;
+}
@@ -31,6 +31,36 @@
 #define FLASH_READ_WRITE_H
 
 
+/**
+  Start writing SPM_PAGESIZE data to the specific address of Flash Memory.
+  The data is loaded into the SPM temporary page buffer and the page erase
+  is issued without waiting, so the caller is free to use page_buffer again
+  while the RWW section is busy.
+
+  @param[in]        page_buffer           Buffer pointer of the data.
+  @param[in]        page_number           Page Number where data need to be write.
+
+**/
+void start_flash_memory_page_write(const uint8_t *page_buffer, uint16_t page_number);
+
+
+/**
+  Move the pending page write one step forward without blocking. Issues the
+  page write once the erase is over and re-enables the RWW section once the
+  write is over.
+
+**/
+void service_flash_memory_page_write();
+
+
+/**
+  Wait until the pending page write is completed and the RWW section is
+  readable again.
+
+**/
+void wait_flash_memory_page_write();
+
+
 /**
   Write SPM_PAGESIZE data to the specific address of Flash Memory.
 
@@ -50,4 +80,29 @@ void write_to_flash_memory_page(const uint8_t *page_buffer, uint16_t page_number
 **/
 void read_from_flash_memory_page(uint8_t *page_buffer, uint16_t page_number);
 
+
+/**
+  Compare SPM_PAGESIZE data with the specific page of Flash Memory.
+
+  @param[in]        page_buffer           Buffer pointer of the data.
+  @param[in]        page_number           Page Number which need to be compared.
+
+  @retval           true                  Flash page holds the same data.
+  @retval           false                 Flash page differs.
+
+**/
+uint8_t is_flash_memory_page_equal(const uint8_t *page_buffer, uint16_t page_number);
+
+
+/**
+  Check whether a page of Flash Memory is erased, all bytes 0xFF.
+
+  @param[in]        page_number           Page Number which need to be checked.
+
+  @retval           true                  Flash page is blank.
+  @retval           false                 Flash page holds data.
+
+**/
+uint8_t is_flash_memory_page_blank(uint16_t page_number);
+
 #endif //FLASH_READ_WRITE_H
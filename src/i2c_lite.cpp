@@ -28,20 +28,48 @@
 
 
 #include <avr/io.h>
+#include <util/twi.h>
 
 #include "ialoy_code.h"
 #include "i2c_lite.h"
+#include "serial_lite.h"
+
+
+#ifndef I2C_CLOCK
+#define I2C_CLOCK 100000UL
+#endif
+
+#if (F_CPU / I2C_CLOCK) < 16
+#error "I2C_CLOCK is too high for F_CPU"
+#endif
+
+// SCL = F_CPU / (16 + 2 * TWBR * prescaler), pick the smallest prescaler that fits TWBR
+#define I2C_TWBR_PRESCALER_1    (((F_CPU / I2C_CLOCK) - 16) / 2)
+
+#if I2C_TWBR_PRESCALER_1 <= 255
+#define I2C_PRESCALER_BITS      0
+#define I2C_TWBR_VALUE          I2C_TWBR_PRESCALER_1
+#elif (I2C_TWBR_PRESCALER_1 / 4) <= 255
+#define I2C_PRESCALER_BITS      (1 << TWPS0)
+#define I2C_TWBR_VALUE          (I2C_TWBR_PRESCALER_1 / 4)
+#elif (I2C_TWBR_PRESCALER_1 / 16) <= 255
+#define I2C_PRESCALER_BITS      (1 << TWPS1)
+#define I2C_TWBR_VALUE          (I2C_TWBR_PRESCALER_1 / 16)
+#else
+#define I2C_PRESCALER_BITS      ((1 << TWPS1) | (1 << TWPS0))
+#define I2C_TWBR_VALUE          (I2C_TWBR_PRESCALER_1 / 64)
+#endif
 
 
 /**
-  Initilize the i2c bus to read EEPROM.
+  Initilize the i2c bus to read EEPROM. The clock is set at build time by
+  I2C_CLOCK, default 100 kHz.
 
 **/
 void i2c_lite_init()
 {
-    // Set prescaler for 100 kHz
-    TWSR &= ~((1 << TWPS1) | (1 << TWPS0));
-    TWBR = ((F_CPU / 100000) - 16) / 2;
+    TWSR = (TWSR & ~((1 << TWPS1) | (1 << TWPS0))) | I2C_PRESCALER_BITS;
+    TWBR = I2C_TWBR_VALUE;
 }
 
 
@@ -52,7 +80,8 @@ void i2c_lite_init()
 void i2c_lite_start()
 {
     TWCR = (1 << TWINT) | (1 << TWSTA) | (1 << TWEN);
-    while (!(TWCR & (1 << TWINT)));
+    while (!(TWCR & (1 << TWINT)))
+        service_serial_output();
 }
 
 
@@ -63,7 +92,8 @@ void i2c_lite_start()
 void i2c_lite_stop()
 {
     TWCR = (1 << TWINT) | (1 << TWSTO) | (1 << TWEN);
-    while ((TWCR & (1 << TWSTO)));
+    while ((TWCR & (1 << TWSTO)))
+        service_serial_output();
 }
 
 
@@ -77,7 +107,8 @@ void i2c_lite_write(uint8_t data)
 {
     TWDR = data;
     TWCR = (1 << TWINT) | (1 << TWEN);
-    while (!(TWCR & (1 << TWINT)));
+    while (!(TWCR & (1 << TWINT)))
+        service_serial_output();
 }
 
 
@@ -103,8 +134,43 @@ uint8_t i2c_lite_read(uint8_t *data, uint8_t ack)
         {
             return RETURN_CODE_FAILURE;
         }
+        service_serial_output();
     }
     *data = TWDR;
 
     return RETURN_CODE_SUCCESS;
 }
+
+
+/**
+  Poll the device with its write address until it acknowledges. Used to wait
+  for the end of the EEPROM internal write cycle.
+
+  @param[in]        address               7 bit i2c address of the device.
+  @param[out]       poll_count            Optional, number of polls sent.
+
+  @retval           RETURN_CODE_FAILURE   Device did not respond in I2C_ACK_POLL_MAX polls.
+  @retval           RETURN_CODE_SUCCESS   Device acknowledged its address.
+
+**/
+uint8_t i2c_lite_poll_ack(uint8_t address, uint16_t *poll_count)
+{
+    uint16_t polls = 0;
+    uint8_t status;
+
+    do
+    {
+        i2c_lite_start();
+        i2c_lite_write((address << 1) | TW_WRITE);
+        status = TW_STATUS;
+        polls++;
+    }
+    while (status != TW_MT_SLA_ACK && polls < I2C_ACK_POLL_MAX);
+
+    i2c_lite_stop();
+
+    if (poll_count)
+        *poll_count = polls;
+
+    return (status == TW_MT_SLA_ACK) ? RETURN_CODE_SUCCESS : RETURN_CODE_FAILURE;
+}
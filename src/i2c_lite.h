@@ -30,9 +30,12 @@
 #ifndef I2C_LITE_H
 #define I2C_LITE_H
 
+#include <stddef.h>
+
 
 /**
-  Initilize the i2c bus to read EEPROM.
+  Initilize the i2c bus to read EEPROM. The clock is set at build time by
+  I2C_CLOCK, default 100 kHz.
 
 **/
 void i2c_lite_init();
@@ -73,4 +76,18 @@ void i2c_lite_write(uint8_t data);
 **/
 uint8_t i2c_lite_read(uint8_t *data, uint8_t ack);
 
+
+/**
+  Poll the device with its write address until it acknowledges. Used to wait
+  for the end of the EEPROM internal write cycle.
+
+  @param[in]        address               7 bit i2c address of the device.
+  @param[out]       poll_count            Optional, number of polls sent.
+
+  @retval           RETURN_CODE_FAILURE   Device did not respond in I2C_ACK_POLL_MAX polls.
+  @retval           RETURN_CODE_SUCCESS   Device acknowledged its address.
+
+**/
+uint8_t i2c_lite_poll_ack(uint8_t address, uint16_t *poll_count = NULL);
+
 #endif //I2C_LITE_H
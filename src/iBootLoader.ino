@@ -30,6 +30,7 @@
 
 #include <avr/io.h>
 #include <avr/wdt.h>
+#include <string.h>
 
 #include "watchdog_timer.h"
 #include "ialoy_code.h"
@@ -37,65 +38,1642 @@
 #include "i2c_lite.h"
 #include "flash_read_write.h"
 #include "eeprom_read_write.h"
+#include "crc_lite.h"
+#include "image_header.h"
+#include "lz_lite.h"
+#include "record_ring.h"
+#include "boot_timing.h"
+#include "fast_boot.h"
+#include "serial_ingest.h"
+#include "boot_services.h"
+#include "target_profile.h"
 
+#ifndef APP_START_ADDRESS
 #define APP_START_ADDRESS           0x0000
-#define EEPROM_FIRMWARE_SIZE        30720  // 30 kilobytes
-#define FIRMWARE_MAX_PAGE           (EEPROM_FIRMWARE_SIZE / SPM_PAGESIZE)
+#endif
+
+#define FWU_MODE_UNKNOWN            0x00
+#define FWU_MODE_ENABLED            0xEE
+#define FWU_MODE_DISABLED           0xDD
+
+#define FIRMWARE_SLOT_1             1
+#define FIRMWARE_SLOT_2             2
+
+#define FIRMWARE_SLOT_1_PAGE_START  0
+#define FIRMWARE_SLOT_1_PAGE_END    FIRMWARE_MAX_PAGE
+
+#define FIRMWARE_SLOT_2_PAGE_START  FIRMWARE_MAX_PAGE
+#define FIRMWARE_SLOT_2_PAGE_END    (FIRMWARE_MAX_PAGE + FIRMWARE_MAX_PAGE)
+
+#define CONFIG_PAGE_SIZE            8
+#define CONFIG_PAGE_NUMBER          EEPROM_CONFIG_PAGE_NUMBER
+
+#define FWU_MODE_ADDRESS            0
+#define FWU_SLOT_ADDRESS            1
+#define FWU_BKUP_MODE_ADDRESS       2
+#define FWU_RECOVERY_MODE_ADDRESS   3
+#define FWU_MIRROR_SLOT_ADDRESS     4
+
+#define IMAGE_HEADER_PAGE(slot)     (CONFIG_PAGE_NUMBER + (slot))
+
+#define JOURNAL_PAGE_NUMBER         (CONFIG_PAGE_NUMBER + 3)
+
+#define CONFIG_RING_PAGE_NUMBER     (CONFIG_PAGE_NUMBER + 4)
+#define CONFIG_RING_PAGE_COUNT      8
+#define CONFIG_RING_RECORD_COUNT    (CONFIG_RING_PAGE_COUNT * RING_RECORDS_PER_PAGE)
+#define CONFIG_BLANK                0xFF
+#define JOURNAL_MAGIC               0x4A52
+#define JOURNAL_PAGE_INTERVAL       16
+#define JOURNAL_MARK_COUNT          (FIRMWARE_MAX_PAGE / JOURNAL_PAGE_INTERVAL)
+#define JOURNAL_MARK_SET            0x00
+#define JOURNAL_NOT_STARTED         ((flash_page_t)-1)
+#define BACKUP_MAP_PAGE_NUMBER      (CONFIG_PAGE_NUMBER + 12)
+#define PAGE_MAP_SIZE               ((FIRMWARE_MAX_PAGE + 7) / 8)
+#define SLOT_STREAM_CLOSED          0xFFFF
+
+#ifndef VERIFY_ENABLE
+#define VERIFY_ENABLE 0
+#endif
+
+#ifndef JOURNAL_ENABLE
+#define JOURNAL_ENABLE 0
+#endif
+
+#ifndef CONFIG_RING_ENABLE
+#define CONFIG_RING_ENABLE 0
+#endif
+
+#ifndef AB_SLOTS_ENABLE
+#define AB_SLOTS_ENABLE 0
+#endif
+
+#ifndef DIFF_BACKUP_ENABLE
+#define DIFF_BACKUP_ENABLE 0
+#endif
+
+#ifndef OCCUPANCY_MAP_ENABLE
+#define OCCUPANCY_MAP_ENABLE 0
+#endif
+
+#define OTHER_SLOT(slot)            ((slot) == FIRMWARE_SLOT_2 ? FIRMWARE_SLOT_1 : FIRMWARE_SLOT_2)
+#define SLOT_PAGE_START(slot)       ((slot) == FIRMWARE_SLOT_2 ? FIRMWARE_SLOT_2_PAGE_START : FIRMWARE_SLOT_1_PAGE_START)
+#define FWU_SOURCE_SLOT(config)     ((config)[FWU_SLOT_ADDRESS] == FIRMWARE_SLOT_2 ? FIRMWARE_SLOT_2 : FIRMWARE_SLOT_1)
+
+/*
+Without A/B slots an update always comes from slot 1 and the rollback from
+slot 2. With A/B slots either slot can hold the update; the armed config
+points at the other slot and is told apart by its recovery mode.
+*/
+
+#if AB_SLOTS_ENABLE
+#define FWU_IS_ROLLBACK(config)     ((config)[FWU_RECOVERY_MODE_ADDRESS] == FWU_MODE_ENABLED)
+#else
+#define FWU_IS_ROLLBACK(config)     ((config)[FWU_SLOT_ADDRESS] == FIRMWARE_SLOT_2)
+#endif
+
+#if DELTA_ENABLE && FIRMWARE_MAX_PAGE > 0xFF
+#error "Delta images address flash pages with one byte, the slot has more pages"
+#endif
+
+#if DELTA_ENABLE && !JOURNAL_ENABLE
+#error "A patch interrupted by a power loss can only be recovered with the update journal"
+#endif
+
+#if FAST_BOOT_ENABLE && !CONFIG_RING_ENABLE
+#error "The fast boot hint names a config ring record, it needs the config ring"
+#endif
+
+#if FAST_BOOT_ENABLE && CONFIG_RING_RECORD_COUNT > 0x100
+#error "The fast boot hint holds a one byte config ring index, the ring has more records"
+#endif
+
+#if SERIAL_INGEST_ENABLE && (SPM_PAGESIZE > 128 || FIRMWARE_MAX_PAGE > 0xFF)
+#error "Serial ingest frames carry up to 128 data bytes and a one byte page number"
+#endif
+
+#if OCCUPANCY_MAP_ENABLE && IMAGE_OCCUPANCY_OFFSET + PAGE_MAP_SIZE > SPM_PAGESIZE
+#error "Occupancy map does not fit in the image header page"
+#endif
+
+#if BOOT_SERVICES_ENABLE && (FLASHEND > 0xFFFF || FIRMWARE_MAX_PAGE > 0x100)
+#error "The service table needs near pointers and one byte slot page numbers"
+#endif
+
+/*
+The services run on the RAM of the application. The serial output ring and
+the stream address of EEPROMs beyond 64 KB are static, so they would be
+written over the data of the application.
+*/
+
+#if BOOT_SERVICES_ENABLE && (SERIAL_ENABLE || EEPROM_SIZE > 0x10000)
+#error "The service table needs serial output disabled and at most 64 KB of EEPROM"
+#endif
+
+
+#if JOURNAL_ENABLE
+/*
+Progress of an update while the flash is being written. The header is written
+once when the flash copy starts, then one mark byte is set for every
+JOURNAL_PAGE_INTERVAL pages committed to the flash. Every byte is written at
+most once per update.
+*/
+
+typedef struct
+{
+    uint16_t magic;
+    uint8_t  slot;
+    uint8_t  reserved;
+    uint32_t checksum;                      // CRC-32 of the image being written.
+    uint8_t  marks[JOURNAL_MARK_COUNT];
+} update_journal_t;
+#endif
+
+
+#if DIFF_BACKUP_ENABLE
+/*
+One bit per flash page, set for the pages a differential backup holds. It is
+filled while the update is verified, or read with a backup to restore.
+*/
+
+static uint8_t backup_page_map[PAGE_MAP_SIZE];
+
+#define IS_PAGE_IN_MAP(page)        (backup_page_map[(page) / 8] & _BV((page) % 8))
+#define IS_MAP_RUN_START(page)      (IS_PAGE_IN_MAP(page) && ((page) == 0 || !IS_PAGE_IN_MAP((page) - 1)))
+#define IS_MAP_RUN_END(page)        (IS_PAGE_IN_MAP(page) && ((page) + 1 == FIRMWARE_MAX_PAGE || !IS_PAGE_IN_MAP((page) + 1)))
+#endif
+
+
+#if OCCUPANCY_MAP_ENABLE
+/*
+One bit per page of the image being applied, set for the pages which hold
+data. Blank pages are not stored in the slot, they read as 0xFF.
+*/
+
+static uint8_t occupancy_map[PAGE_MAP_SIZE];
+
+#define IS_PAGE_OCCUPIED(page)      (occupancy_map[(page) / 8] & _BV((page) % 8))
+#endif
+
+// EEPROM page the open slot stream reads next, see read_slot_page().
+static uint16_t slot_stream_page = SLOT_STREAM_CLOSED;
+
+
+#ifndef VERSION
+#define VERSION "0.0.0.0000"
+#endif
+
+
+/**
+  Initlize the Application entry point pointer and call the pointer
+  to jump to the application.
+
+**/
+void jump_to_application()
+{
+    void (*start_app)(void) = (void (*)(void))APP_START_ADDRESS;
+    flush_serial_output();
+    cli();
+    start_app();
+}
+
+
+/**
+  Read the image header of a firmware slot and get the number of pages the
+  image occupies. Slots without a valid header are taken as full.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[out]       image_header          Buffer for the image header.
+
+  @retval           flash_page_t          Number of pages of the image.
+
+**/
+flash_page_t read_image_header(uint8_t slot, image_header_t *image_header)
+{
+    if (read_from_EEPROM_page((uint8_t *)image_header, IMAGE_HEADER_PAGE(slot),
+                              sizeof(image_header_t)) == RETURN_CODE_SUCCESS &&
+        image_header->magic == IMAGE_HEADER_MAGIC &&
+        image_header->length <= EEPROM_FIRMWARE_SIZE)
+    {
+        return (image_header->length + SPM_PAGESIZE - 1) / SPM_PAGESIZE;
+    }
+
+    memset(image_header, 0, sizeof(image_header_t));
+    return FIRMWARE_MAX_PAGE;
+}
+
+
+#if JOURNAL_ENABLE
+/**
+  Read the update journal and get the flash page where an interrupted copy
+  of the image can resume.
+
+  @param[in]        slot                  Firmware slot number of the image.
+  @param[in]        image_header          Image header of the slot.
+
+  @retval           JOURNAL_NOT_STARTED   No copy was interrupted, the flash is intact.
+  @retval           flash_page_t          First page to copy; 0 when the journal
+                                          belongs to another image.
+
+**/
+flash_page_t read_journal(uint8_t slot, image_header_t *image_header)
+{
+    update_journal_t journal;
+    uint8_t mark_index = 0;
+
+    if (read_from_EEPROM_page((uint8_t *)&journal, JOURNAL_PAGE_NUMBER, sizeof(journal)) == RETURN_CODE_FAILURE ||
+        journal.magic != JOURNAL_MAGIC)
+        return JOURNAL_NOT_STARTED;
+
+    if (journal.slot != slot || journal.checksum != image_header->checksum)
+        return 0;
+
+    while (mark_index < JOURNAL_MARK_COUNT && journal.marks[mark_index] == JOURNAL_MARK_SET)
+    {
+        mark_index++;
+    }
+
+    return mark_index * JOURNAL_PAGE_INTERVAL;
+}
+
+
+/**
+  Start a new update journal, before the first flash page is written.
+
+  @param[in]        slot                  Firmware slot number of the image.
+  @param[in]        image_header          Image header of the slot.
+
+**/
+void start_journal(uint8_t slot, image_header_t *image_header)
+{
+    update_journal_t journal;
+
+    memset(&journal, 0xFF, sizeof(journal));
+    journal.magic    = JOURNAL_MAGIC;
+    journal.slot     = slot;
+    journal.checksum = image_header->checksum;
+    write_to_EEPROM_page((uint8_t *)&journal, JOURNAL_PAGE_NUMBER, sizeof(journal));
+}
+
+
+/**
+  Record in the update journal that the flash pages before a page are written.
+
+  @param[in]        page_number           Flash page, a multiple of JOURNAL_PAGE_INTERVAL.
+
+**/
+void mark_journal(flash_page_t page_number)
+{
+    uint8_t mark = JOURNAL_MARK_SET;
+
+    write_to_EEPROM_page_offset(&mark, JOURNAL_PAGE_NUMBER,
+                                offsetof(update_journal_t, marks) + page_number / JOURNAL_PAGE_INTERVAL - 1, 1);
+}
+
+
+/**
+  Close the update journal once the flash holds the whole image.
+
+**/
+void clear_journal()
+{
+    uint16_t magic = 0;
+
+    write_to_EEPROM_page((uint8_t *)&magic, JOURNAL_PAGE_NUMBER, sizeof(magic));
+}
+#endif
+
+
+/**
+  Compute the CRC-32 of the first pages of the flash.
+
+  @param[in]        page_count            Number of pages to include.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           uint32_t              CRC-32 of the pages.
+
+**/
+uint32_t get_flash_checksum(flash_page_t page_count, uint8_t *page_buffer)
+{
+    uint32_t checksum = 0;
+
+    for(flash_page_t flash_page_counter = 0; flash_page_counter < page_count; flash_page_counter++)
+    {
+        read_from_flash_memory_page(page_buffer, flash_page_counter);
+        checksum = crc_lite_update(checksum, page_buffer, SPM_PAGESIZE);
+    }
+
+    return checksum;
+}
+
+
+#if CONFIG_RING_ENABLE
+/**
+  Commit a config as the newest record of the config ring.
+
+  @param[in]        config_buffer         Buffer of the config.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Config written successfully.
+
+**/
+uint8_t write_config(uint8_t *config_buffer)
+{
+    ring_record_t record;
+
+    memcpy(record.data, config_buffer, RING_RECORD_DATA_SIZE);
+    return append_ring_record(CONFIG_RING_PAGE_NUMBER, CONFIG_RING_PAGE_COUNT, &record, sizeof(record));
+}
+
+
+/**
+  Read the config from the newest record of the config ring.
+
+  While the ring is empty the config is read from the fixed config page, as
+  written by a bootloader or a tool which does not know the ring. A config
+  found there is moved into the ring once; from then on the fixed page is not
+  read again. With an empty ring and a blank page the config reads as blank.
+
+  @param[out]       config_buffer         Buffer for the config.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read the config.
+  @retval           RETURN_CODE_SUCCESS   Config read successfully.
+
+**/
+uint8_t read_config(uint8_t *config_buffer)
+{
+    ring_record_t record;
+
+    if (find_ring_record(CONFIG_RING_PAGE_NUMBER, CONFIG_RING_PAGE_COUNT,
+                         &record, sizeof(record)) == RETURN_CODE_SUCCESS)
+    {
+        memcpy(config_buffer, record.data, RING_RECORD_DATA_SIZE);
+        return RETURN_CODE_SUCCESS;
+    }
+
+    if (read_from_EEPROM_page(config_buffer, CONFIG_PAGE_NUMBER, CONFIG_PAGE_SIZE) == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+    if (config_buffer[FWU_MODE_ADDRESS] != CONFIG_BLANK)
+        write_config(config_buffer);
+
+    return RETURN_CODE_SUCCESS;
+}
+#else
+/**
+  Write the config to the fixed config page.
+
+  @param[in]        config_buffer         Buffer of the config.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Config written successfully.
+
+**/
+uint8_t write_config(uint8_t *config_buffer)
+{
+    return write_to_EEPROM_page(config_buffer, CONFIG_PAGE_NUMBER, CONFIG_PAGE_SIZE);
+}
+
+
+/**
+  Read the config from the fixed config page.
+
+  @param[out]       config_buffer         Buffer for the config.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read the config.
+  @retval           RETURN_CODE_SUCCESS   Config read successfully.
+
+**/
+uint8_t read_config(uint8_t *config_buffer)
+{
+    return read_from_EEPROM_page(config_buffer, CONFIG_PAGE_NUMBER, CONFIG_PAGE_SIZE);
+}
+#endif
+
+
+/**
+  Load the default config, used once an update is done, recovered or skipped.
+
+  @param[out]       config_buffer         Buffer for the config.
+
+**/
+void set_default_config(uint8_t *config_buffer)
+{
+    config_buffer[FWU_MODE_ADDRESS]          = FWU_MODE_DISABLED;
+    config_buffer[FWU_SLOT_ADDRESS]          = FIRMWARE_SLOT_1;
+    config_buffer[FWU_BKUP_MODE_ADDRESS]     = FWU_MODE_ENABLED;
+    config_buffer[FWU_RECOVERY_MODE_ADDRESS] = FWU_MODE_DISABLED;
+}
+
+
+#if FAST_BOOT_ENABLE
+/**
+  Check that no config was written since the fast boot hint was set. Any
+  writer of the ring, the bootloader, an application or manage_fwu_eeprom.py,
+  appends at the record named by the hint; the fixed config page is not read
+  once the ring holds a record. One record is read.
+
+  @param[in]        hint                  Fast boot hint.
+
+  @retval           true                  Config unchanged, no update pending.
+  @retval           false                 Config written since, read it.
+
+**/
+uint8_t is_config_unchanged(fast_boot_hint_t *hint)
+{
+    ring_record_t record;
+
+    if (hint->next_record >= CONFIG_RING_RECORD_COUNT)
+        return false;
+
+    // A record left from the last lap of the ring has an older sequence number.
+    return read_ring_record(CONFIG_RING_PAGE_NUMBER, hint->next_record,
+                            &record, sizeof(record)) == RETURN_CODE_FAILURE ||
+           record.sequence != hint->next_sequence;
+}
+
+
+/**
+  Point the fast boot hint at the config ring record after the current one.
+
+**/
+void update_fast_boot_hint()
+{
+    ring_record_t record;
+    uint16_t index;
+
+    if (find_ring_record(CONFIG_RING_PAGE_NUMBER, CONFIG_RING_PAGE_COUNT,
+                         &record, sizeof(record), &index) == RETURN_CODE_SUCCESS)
+        set_fast_boot_hint((index + 1) % CONFIG_RING_RECORD_COUNT, record.sequence + 1);
+    else
+        clear_fast_boot_hint();
+}
+#endif
+
+
+/**
+  Compute the CRC-32 of the start of a firmware slot, read as one sequential
+  stream.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        length                Number of bytes from the start of the slot.
+  @param[in]        page_buffer           Buffer for one page.
+  @param[out]       checksum              CRC-32 of the bytes.
+
+  @retval           RETURN_CODE_FAILURE   Length beyond the slot or read failed.
+  @retval           RETURN_CODE_SUCCESS   Checksum computed.
+
+**/
+uint8_t read_slot_checksum(uint16_t eeprom_page_offset, uint16_t length, uint8_t *page_buffer, uint32_t *checksum)
+{
+    uint16_t chunk_length;
+    uint8_t status = RETURN_CODE_SUCCESS;
+
+    *checksum = 0;
+
+    if (length > EEPROM_FIRMWARE_SIZE ||
+        open_EEPROM_stream(eeprom_page_offset) == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+    while (length > 0 && status == RETURN_CODE_SUCCESS)
+    {
+        chunk_length = length < SPM_PAGESIZE ? length : SPM_PAGESIZE;
+        status = read_EEPROM_stream(page_buffer, chunk_length);
+        *checksum = crc_lite_update(*checksum, page_buffer, chunk_length);
+        length -= chunk_length;
+    }
+    close_EEPROM_stream();
+
+    return status;
+}
+
+
+/**
+  Verify the stored data of a firmware slot against the CRC-32 of its image
+  header. The slot is read as one sequential stream, nothing is written.
+  Slots without a valid header carry no CRC and are taken as valid.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        image_header          Image header of the slot.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           RETURN_CODE_FAILURE   Stored data does not match the CRC.
+  @retval           RETURN_CODE_SUCCESS   Stored data is valid.
+
+**/
+uint8_t verify_slot_image(uint16_t eeprom_page_offset, image_header_t *image_header, uint8_t *page_buffer)
+{
+    uint32_t checksum;
+
+    if (image_header->magic != IMAGE_HEADER_MAGIC)
+        return RETURN_CODE_SUCCESS;
+
+    if (read_slot_checksum(eeprom_page_offset, image_header->stored_length, page_buffer,
+                           &checksum) == RETURN_CODE_FAILURE ||
+        checksum != image_header->checksum)
+        return RETURN_CODE_FAILURE;
+
+    return RETURN_CODE_SUCCESS;
+}
+
+
+/**
+  Close the slot stream opened by read_slot_page().
+
+**/
+void close_slot_stream()
+{
+    if (slot_stream_page != SLOT_STREAM_CLOSED)
+        close_EEPROM_stream();
+
+    slot_stream_page = SLOT_STREAM_CLOSED;
+}
+
+
+/**
+  Read one page of an image from a firmware slot. Pages read in order share
+  one sequential stream, which stays open until close_slot_stream(). With an
+  occupancy map, blank pages are filled with 0xFF and not read at all.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        page_number           Page of the image.
+  @param[out]       page_buffer           Buffer for one page.
+  @param[in]        idle_task             Called while waiting on the bus, or NULL.
+
+  @retval           RETURN_CODE_FAILURE   Read failed.
+  @retval           RETURN_CODE_SUCCESS   Page read successfully.
+
+**/
+uint8_t read_slot_page(uint16_t eeprom_page_offset, flash_page_t page_number, uint8_t *page_buffer,
+                       void (*idle_task)(void))
+{
+    uint16_t eeprom_page = eeprom_page_offset + page_number;
+
+#if OCCUPANCY_MAP_ENABLE
+    if (!IS_PAGE_OCCUPIED(page_number))
+    {
+        memset(page_buffer, 0xFF, SPM_PAGESIZE);
+        return RETURN_CODE_SUCCESS;
+    }
+#endif
+
+    if (eeprom_page != slot_stream_page)
+    {
+        close_slot_stream();
+
+        if (open_EEPROM_stream(eeprom_page) == RETURN_CODE_FAILURE)
+            return RETURN_CODE_FAILURE;
+    }
+
+    slot_stream_page = eeprom_page + 1;
+
+    if (read_EEPROM_stream(page_buffer, SPM_PAGESIZE, idle_task) == RETURN_CODE_FAILURE)
+    {
+        close_slot_stream();
+        return RETURN_CODE_FAILURE;
+    }
+
+    return RETURN_CODE_SUCCESS;
+}
+
+
+#if OCCUPANCY_MAP_ENABLE
+/**
+  Load the occupancy map of the image in a slot. Images without a map have
+  all pages set.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        image_header          Image header of the slot.
+  @param[in]        page_buffer           Buffer for one page.
+
+**/
+void read_occupancy_map(uint8_t slot, image_header_t *image_header, uint8_t *page_buffer)
+{
+    memset(occupancy_map, 0xFF, PAGE_MAP_SIZE);
+
+    if ((image_header->flags & IMAGE_FLAG_OCCUPANCY) &&
+        read_from_EEPROM_page(page_buffer, IMAGE_HEADER_PAGE(slot),
+                              IMAGE_OCCUPANCY_OFFSET + PAGE_MAP_SIZE) == RETURN_CODE_SUCCESS)
+        memcpy(occupancy_map, &page_buffer[IMAGE_OCCUPANCY_OFFSET], PAGE_MAP_SIZE);
+}
+#endif
+
+
+#if DIFF_BACKUP_ENABLE || OCCUPANCY_MAP_ENABLE
+/**
+  Verify a raw image in a slot against the CRC-32 of its image header, page
+  by page, so blank pages of the occupancy map are not read. With
+  differential backups the page map bits of the pages which equal the flash
+  are cleared as well; the compare costs no extra bus time.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        image_header          Image header of the slot.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           RETURN_CODE_FAILURE   Stored data does not match the CRC.
+  @retval           RETURN_CODE_SUCCESS   Stored data is valid.
+
+**/
+uint8_t verify_slot_pages(uint16_t eeprom_page_offset, image_header_t *image_header, uint8_t *page_buffer)
+{
+    uint16_t length = image_header->stored_length;
+    uint16_t chunk_length;
+    flash_page_t page_number = 0;
+    uint32_t checksum = 0;
+    uint8_t status = RETURN_CODE_SUCCESS;
+
+    if (image_header->magic != IMAGE_HEADER_MAGIC)
+        return RETURN_CODE_SUCCESS;
+
+    if (length > EEPROM_FIRMWARE_SIZE)
+        return RETURN_CODE_FAILURE;
+
+    while (length > 0 && status == RETURN_CODE_SUCCESS)
+    {
+        chunk_length = length < SPM_PAGESIZE ? length : SPM_PAGESIZE;
+        status = read_slot_page(eeprom_page_offset, page_number, page_buffer, NULL);
+        checksum = crc_lite_update(checksum, page_buffer, chunk_length);
+
+#if DIFF_BACKUP_ENABLE
+        if (chunk_length == SPM_PAGESIZE && is_flash_memory_page_equal(page_buffer, page_number))
+            backup_page_map[page_number / 8] &= ~_BV(page_number % 8);
+#endif
+
+        page_number++;
+        length -= chunk_length;
+    }
+    close_slot_stream();
+
+    if (status == RETURN_CODE_FAILURE || checksum != image_header->checksum)
+        return RETURN_CODE_FAILURE;
+
+    return RETURN_CODE_SUCCESS;
+}
+#endif
+
+
+#if DIFF_BACKUP_ENABLE
+/**
+  Read the page map of a differential backup and verify the backup against
+  its image header. The flash pages outside the map have to be the ones the
+  backup was made next to, otherwise a restore would mix two images.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        image_header          Image header of the slot.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           RETURN_CODE_FAILURE   Backup or flash does not match the header.
+  @retval           RETURN_CODE_SUCCESS   Backup can be restored.
+
+**/
+uint8_t verify_backup_pages(uint16_t eeprom_page_offset, image_header_t *image_header, uint8_t *page_buffer)
+{
+    flash_page_t image_page_count = image_header->length / SPM_PAGESIZE;
+    uint32_t checksum;
+    uint32_t base_checksum = 0;
+    uint8_t status = RETURN_CODE_SUCCESS;
+
+    if (read_from_EEPROM_page(backup_page_map, BACKUP_MAP_PAGE_NUMBER, PAGE_MAP_SIZE) == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+    checksum = crc_lite_update(0, backup_page_map, PAGE_MAP_SIZE);
+
+    for(flash_page_t flash_page_counter = 0;
+        flash_page_counter < image_page_count && status == RETURN_CODE_SUCCESS;
+        flash_page_counter++)
+    {
+        if (!IS_PAGE_IN_MAP(flash_page_counter))
+        {
+            read_from_flash_memory_page(page_buffer, flash_page_counter);
+            base_checksum = crc_lite_update(base_checksum, page_buffer, SPM_PAGESIZE);
+            continue;
+        }
+
+        // A run of backed up pages is read as one sequential stream.
+        if (IS_MAP_RUN_START(flash_page_counter))
+            status = open_EEPROM_stream(eeprom_page_offset + flash_page_counter);
+
+        if (status == RETURN_CODE_SUCCESS)
+            status = read_EEPROM_stream(page_buffer, SPM_PAGESIZE);
+
+        if (status == RETURN_CODE_FAILURE || IS_MAP_RUN_END(flash_page_counter) ||
+            flash_page_counter + 1 == image_page_count)
+            close_EEPROM_stream();
+
+        checksum = crc_lite_update(checksum, page_buffer, SPM_PAGESIZE);
+    }
+
+    if (status == RETURN_CODE_FAILURE ||
+        checksum != image_header->checksum || base_checksum != image_header->base_checksum)
+        return RETURN_CODE_FAILURE;
+
+    return RETURN_CODE_SUCCESS;
+}
+#endif
+
+
+/**
+  Check if an image can be applied on the running flash. The image needs
+  only supported flags, a valid CRC and, for a delta image, the flash it
+  was built against.
+
+  The CRC pass reads the whole slot once more before the first erase. It
+  only pays off while the flash holds an image a broken slot must not
+  replace. A recovery or a resumed copy overwrites a flash which is no
+  good anyway; for raw and packed images the CRC readback in
+  program_image() then catches a broken slot, so the slot is read once.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        image_header          Image header of the slot.
+  @param[in]        keeps_flash           Flash holds an image to keep on a bad CRC.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           RETURN_CODE_FAILURE   Image can not be applied.
+  @retval           RETURN_CODE_SUCCESS   Image can be applied.
+
+**/
+uint8_t is_image_applicable(uint16_t eeprom_page_offset, image_header_t *image_header, uint8_t keeps_flash,
+                            uint8_t *page_buffer)
+{
+    uint8_t status;
+
+    if (image_header->flags & ~IMAGE_SUPPORTED_FLAGS)
+        return RETURN_CODE_FAILURE;
+
+#if !VERIFY_ENABLE
+    (void)eeprom_page_offset;
+    (void)keeps_flash;
+    (void)page_buffer;
+#endif
+
+#if VERIFY_ENABLE
+    // Patches and differential backups are not read back against a CRC, they are always checked first.
+    if (!keeps_flash && !(image_header->flags & (IMAGE_FLAG_DELTA | IMAGE_FLAG_PAGE_MAP)))
+        status = RETURN_CODE_SUCCESS;
+    else
+#endif
+#if DIFF_BACKUP_ENABLE
+    // Pages of packed images and patches can not be compared, all of them are backed up.
+    memset(backup_page_map, 0xFF, PAGE_MAP_SIZE);
+
+    if (image_header->flags & IMAGE_FLAG_PAGE_MAP)
+        status = verify_backup_pages(eeprom_page_offset, image_header, page_buffer);
+    else
+#endif
+#if DIFF_BACKUP_ENABLE || OCCUPANCY_MAP_ENABLE
+    if (!(image_header->flags & (IMAGE_FLAG_COMPRESSED | IMAGE_FLAG_DELTA)))
+        status = verify_slot_pages(eeprom_page_offset, image_header, page_buffer);
+    else
+#endif
+#if VERIFY_ENABLE
+    status = verify_slot_image(eeprom_page_offset, image_header, page_buffer);
+#else
+    status = RETURN_CODE_SUCCESS;
+#endif
+
+    if (status == RETURN_CODE_FAILURE)
+    {
+        print_string("Firmware Image CRC mismatch.\n");
+        return RETURN_CODE_FAILURE;
+    }
+
+#if DELTA_ENABLE
+    if ((image_header->flags & IMAGE_FLAG_DELTA) &&
+        get_flash_checksum(FIRMWARE_MAX_PAGE, page_buffer) != image_header->base_checksum)
+        return RETURN_CODE_FAILURE;
+#endif
+
+    return RETURN_CODE_SUCCESS;
+}
+
+
+/**
+  Back up the running firmware into a slot and write its image header. The
+  backup is skipped when the slot already holds the running image. With
+  differential backups only the pages set in the page map are written.
+
+  @param[in]        slot                  Firmware slot number of the backup.
+  @param[in]        page_buffer           Buffer for one page.
+
+**/
+void backup_flash_to_slot(uint8_t slot, uint8_t *page_buffer)
+{
+    uint16_t eeprom_page_counter;
+    flash_page_t flash_page_counter;
+    flash_page_t image_page_count;
+    flash_page_t backup_page_count = 0;
+    uint32_t checksum;
+    image_header_t image_header;
+    uint16_t write_polls;
+    uint16_t write_polls_max = 0;
+
+    print_string("Old Firmware Backing up ...\n");
+
+    // Only the flash up to the last non blank page holds code.
+    image_page_count = FIRMWARE_MAX_PAGE;
+    while (image_page_count > 0 && is_flash_memory_page_blank(image_page_count - 1))
+    {
+        image_page_count--;
+    }
+
+    checksum = get_flash_checksum(image_page_count, page_buffer);
+
+    /*
+    The slot already holds the running image when its header matches the
+    length and CRC of the flash, e.g. after a retry or a rollback, and the
+    slot data still matches the header; a host may have rewritten the data
+    without invalidating the header.
+    */
+
+    if (read_image_header(slot, &image_header) == image_page_count &&
+        image_header.magic == IMAGE_HEADER_MAGIC &&
+        !(image_header.flags & IMAGE_FLAG_PAGE_MAP) &&
+        image_header.checksum == checksum &&
+        verify_slot_image(SLOT_PAGE_START(slot), &image_header, page_buffer) == RETURN_CODE_SUCCESS)
+    {
+        print_string("Backup in Slot ");
+        print_number(slot);
+        print_string(" is up to date.\n");
+        return;
+    }
+
+    // Invalidate the slot header while its pages are rewritten.
+    memset(&image_header, 0, sizeof(image_header));
+    write_to_EEPROM_page((uint8_t *)&image_header, IMAGE_HEADER_PAGE(slot),
+                         sizeof(image_header));
+
+#if DIFF_BACKUP_ENABLE
+    /*
+    The pages the update leaves as they are stay in the flash, the map tells
+    them apart. When the update changes every page the backup is kept as a
+    plain image, which is restored with the faster sequential copy.
+    */
+
+    flash_page_counter = 0;
+    while (flash_page_counter < image_page_count && IS_PAGE_IN_MAP(flash_page_counter))
+    {
+        flash_page_counter++;
+    }
+
+    checksum = 0;
+    if (flash_page_counter < image_page_count)
+    {
+        write_to_EEPROM_page(backup_page_map, BACKUP_MAP_PAGE_NUMBER, PAGE_MAP_SIZE);
+        checksum = crc_lite_update(0, backup_page_map, PAGE_MAP_SIZE);
+        image_header.flags = IMAGE_FLAG_PAGE_MAP;
+    }
+#endif
+
+    for(flash_page_counter = 0, eeprom_page_counter = SLOT_PAGE_START(slot);
+        flash_page_counter < image_page_count;
+        flash_page_counter++, eeprom_page_counter++)
+    {
+        read_from_flash_memory_page(page_buffer, flash_page_counter);
+
+#if DIFF_BACKUP_ENABLE
+        if (!IS_PAGE_IN_MAP(flash_page_counter))
+        {
+            image_header.base_checksum = crc_lite_update(image_header.base_checksum, page_buffer, SPM_PAGESIZE);
+            continue;
+        }
+
+        checksum = crc_lite_update(checksum, page_buffer, SPM_PAGESIZE);
+#endif
+        backup_page_count++;
+
+        write_to_EEPROM_page(page_buffer, eeprom_page_counter, SPM_PAGESIZE, &write_polls);
+        if (write_polls > write_polls_max)
+            write_polls_max = write_polls;
+
+        LED_PORT ^= _BV(BUILD_IN_LED_PIN);
+    }
+
+    image_header.magic         = IMAGE_HEADER_MAGIC;
+    image_header.length        = image_page_count * SPM_PAGESIZE;
+    image_header.stored_length = image_page_count * SPM_PAGESIZE;
+    image_header.checksum      = checksum;
+    write_to_EEPROM_page((uint8_t *)&image_header, IMAGE_HEADER_PAGE(slot),
+                         sizeof(image_header));
+
+    print_string("Pages backed up: ");
+    print_number(backup_page_count);
+    print_string("\n");
+
+    print_string("EEPROM write cycle polls (max): ");
+    print_number(write_polls_max);
+    print_string("\n");
+}
+
+
+#if AB_SLOTS_ENABLE
+/**
+  Check if a slot mirrors the running firmware. The config records the slot
+  the flash was last programmed from; writers of a slot clear the record or
+  invalidate the slot header, so both have to hold, and the slot data is
+  checked against the header for a writer which did neither. Only a raw
+  image mirrors the flash: a differential backup holds only some pages, a
+  delta image needs the flash it was built against and a compressed one is
+  not recorded.
+
+  @param[in]        slot                  Firmware slot number.
+  @param[in]        config_buffer         Current config.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           RETURN_CODE_SUCCESS   The slot holds the running image.
+  @retval           RETURN_CODE_FAILURE   The slot must be backed up.
+
+**/
+uint8_t is_mirror_slot(uint8_t slot, uint8_t *config_buffer, uint8_t *page_buffer)
+{
+    image_header_t image_header;
+
+    read_image_header(slot, &image_header);
+
+    if (config_buffer[FWU_MIRROR_SLOT_ADDRESS] == slot && image_header.magic == IMAGE_HEADER_MAGIC &&
+        !(image_header.flags & IMAGE_FLAGS_NOT_MIRROR) &&
+        verify_slot_image(SLOT_PAGE_START(slot), &image_header, page_buffer) == RETURN_CODE_SUCCESS)
+        return RETURN_CODE_SUCCESS;
+
+    return RETURN_CODE_FAILURE;
+}
+#endif
+
+
+/**
+  Copy an image from a firmware slot into the flash, starting at a page. Flash
+  pages after the end of the image are blanked and pages which already hold
+  the same data are not erased or written. Blank pages of the occupancy map
+  are not read from the slot, a blank page is only erased.
+
+  The page data is moved into the SPM temporary buffer before the erase
+  starts, so page_buffer is free again while the RWW section is busy. The
+  next page is read from the EEPROM during the erase and write of the
+  current one; the read keeps the flash write moving between bytes.
+
+  With the journal enabled, every JOURNAL_PAGE_INTERVAL pages the read stream
+  is closed to mark the progress in the update journal, the next read opens
+  it again.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        first_page            First flash page to copy.
+  @param[in]        image_page_count      Number of pages of the image.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           flash_page_t          Number of pages skipped.
+
+**/
+flash_page_t copy_image_to_flash(uint16_t eeprom_page_offset, flash_page_t first_page,
+                                 flash_page_t image_page_count, uint8_t *page_buffer)
+{
+    flash_page_t skipped_page_count = 0;
+
+    if (first_page < image_page_count)
+        read_slot_page(eeprom_page_offset, first_page, page_buffer, NULL);
+    else
+        memset(page_buffer, 0xFF, SPM_PAGESIZE);
+
+    for(flash_page_t flash_page_counter = first_page; flash_page_counter < FIRMWARE_MAX_PAGE; flash_page_counter++)
+    {
+#if JOURNAL_ENABLE
+        if (flash_page_counter > first_page && flash_page_counter % JOURNAL_PAGE_INTERVAL == 0)
+        {
+            // The pages before are in the flash, this one is already in page_buffer.
+            close_slot_stream();
+            mark_journal(flash_page_counter);
+        }
+#endif
+
+        if (is_flash_memory_page_equal(page_buffer, flash_page_counter))
+            skipped_page_count++;
+        else
+            start_flash_memory_page_write(page_buffer, flash_page_counter);
+
+        if (flash_page_counter + 1 < image_page_count)
+            read_slot_page(eeprom_page_offset, flash_page_counter + 1, page_buffer, service_flash_memory_page_write);
+        else
+            memset(page_buffer, 0xFF, SPM_PAGESIZE);
+
+        wait_flash_memory_page_write();
+        LED_PORT ^= _BV(BUILD_IN_LED_PIN);
+    }
+
+    close_slot_stream();
+
+    return skipped_page_count;
+}
+
+
+#if COMPRESSION_ENABLE
+/**
+  Decompress an image from the open EEPROM read stream into the flash. Flash
+  pages after the end of the image are blanked and pages which already hold
+  the same data are not erased or written. Every page is written before the
+  next one is decoded, because the decoder reads back references from flash.
+
+  @param[in]        image_page_count      Number of pages of the image.
+  @param[in]        page_buffer           Buffer for one page.
+  @param[out]       skipped_page_count    Number of pages skipped.
+
+  @retval           RETURN_CODE_FAILURE   Compressed data is broken or a written page
+                                          does not read back, flash is partly written.
+  @retval           RETURN_CODE_SUCCESS   Image written successfully.
+
+**/
+uint8_t decompress_image_to_flash(flash_page_t image_page_count, uint8_t *page_buffer,
+                                  flash_page_t *skipped_page_count)
+{
+    lz_lite_state_t lz_state;
+
+    *skipped_page_count = 0;
+    lz_lite_init(&lz_state);
+
+    for(flash_page_t flash_page_counter = 0; flash_page_counter < FIRMWARE_MAX_PAGE; flash_page_counter++)
+    {
+        if (flash_page_counter >= image_page_count)
+            memset(page_buffer, 0xFF, SPM_PAGESIZE);
+        else if (lz_lite_decode_page(&lz_state, page_buffer) == RETURN_CODE_FAILURE)
+            return RETURN_CODE_FAILURE;
+
+        if (is_flash_memory_page_equal(page_buffer, flash_page_counter))
+        {
+            (*skipped_page_count)++;
+        }
+        else
+        {
+            write_to_flash_memory_page(page_buffer, flash_page_counter);
+            if (!is_flash_memory_page_equal(page_buffer, flash_page_counter))
+                return RETURN_CODE_FAILURE;
+        }
+
+        LED_PORT ^= _BV(BUILD_IN_LED_PIN);
+    }
+
+    return RETURN_CODE_SUCCESS;
+}
+#endif
+
+
+#if DELTA_ENABLE
+/**
+  Apply a delta image from the open EEPROM read stream on the flash. Every
+  patched page is rebuilt from the running flash page and the patch data.
+
+  @param[in]        page_buffer           Buffer for one page.
+  @param[out]       patched_page_count    Number of pages patched.
+
+  @retval           RETURN_CODE_FAILURE   Patch data is broken or a page does not
+                                          read back, flash is partly patched.
+  @retval           RETURN_CODE_SUCCESS   Patch applied successfully.
+
+**/
+uint8_t patch_image_in_flash(uint8_t *page_buffer, flash_page_t *patched_page_count)
+{
+    uint8_t page_number;
+    uint8_t counts[2];
+    uint16_t offset;
+
+    *patched_page_count = 0;
+
+    while (read_EEPROM_stream(&page_number, 1) == RETURN_CODE_SUCCESS)
+    {
+        if (page_number == DELTA_END_PAGE)
+            return RETURN_CODE_SUCCESS;
+
+        if (page_number >= FIRMWARE_MAX_PAGE)
+            return RETURN_CODE_FAILURE;
+
+        read_from_flash_memory_page(page_buffer, page_number);
+
+        for(offset = 0; offset < SPM_PAGESIZE; offset += counts[1])
+        {
+            if (read_EEPROM_stream(counts, 2) == RETURN_CODE_FAILURE)
+                return RETURN_CODE_FAILURE;
+
+            offset += counts[0];
+            if (offset + counts[1] > SPM_PAGESIZE)
+                return RETURN_CODE_FAILURE;
+
+            if (read_EEPROM_stream(&page_buffer[offset], counts[1]) == RETURN_CODE_FAILURE)
+                return RETURN_CODE_FAILURE;
+        }
 
-#define EEPROM_CONFIG_START_ADDRESS 0xF000
+        if (!is_flash_memory_page_equal(page_buffer, page_number))
+        {
+            write_to_flash_memory_page(page_buffer, page_number);
+            if (!is_flash_memory_page_equal(page_buffer, page_number))
+                return RETURN_CODE_FAILURE;
+        }
 
-#define FWU_MODE_UNKNOWN            0x00
-#define FWU_MODE_ENABLED            0xEE
-#define FWU_MODE_DISABLED           0xDD
+        (*patched_page_count)++;
+        LED_PORT ^= _BV(BUILD_IN_LED_PIN);
+    }
 
-#define FIRMWARE_SLOT_1             1
-#define FIRMWARE_SLOT_2             2
+    return RETURN_CODE_FAILURE;
+}
+#endif
 
-#define FIRMWARE_SLOT_1_PAGE_START  0
-#define FIRMWARE_SLOT_1_PAGE_END    FIRMWARE_MAX_PAGE
 
-#define FIRMWARE_SLOT_2_PAGE_START  FIRMWARE_MAX_PAGE
-#define FIRMWARE_SLOT_2_PAGE_END    (FIRMWARE_MAX_PAGE + FIRMWARE_MAX_PAGE)
+#if DIFF_BACKUP_ENABLE
+/**
+  Restore a differential backup into the flash. Only the pages of the page
+  map are read from the slot; flash pages after the end of the backup are
+  blanked and pages which already hold the same data are not written. The
+  stream stays open while a page is written, as in copy_image_to_flash().
 
-#define CONFIG_PAGE_SIZE            8
-#define CONFIG_PAGE_NUMBER          (FIRMWARE_MAX_PAGE * 2)
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        image_page_count      Number of pages of the backed up image.
+  @param[in]        page_buffer           Buffer for one page.
+  @param[out]       restored_page_count   Number of pages written.
 
-#define FWU_MODE_ADDRESS            0
-#define FWU_SLOT_ADDRESS            1
-#define FWU_BKUP_MODE_ADDRESS       2
-#define FWU_RECOVERY_MODE_ADDRESS   3
+  @retval           RETURN_CODE_FAILURE   A page read failed or does not read back.
+  @retval           RETURN_CODE_SUCCESS   Backup restored successfully.
 
+**/
+uint8_t restore_backup_pages(uint16_t eeprom_page_offset, flash_page_t image_page_count, uint8_t *page_buffer,
+                             flash_page_t *restored_page_count)
+{
+    uint8_t status = RETURN_CODE_SUCCESS;
 
-#ifndef VERSION
-#define VERSION "0.0.0.0000"
+    *restored_page_count = 0;
+
+    for(flash_page_t flash_page_counter = 0; flash_page_counter < FIRMWARE_MAX_PAGE; flash_page_counter++)
+    {
+        if (flash_page_counter >= image_page_count)
+        {
+            memset(page_buffer, 0xFF, SPM_PAGESIZE);
+        }
+        else if (!IS_PAGE_IN_MAP(flash_page_counter))
+        {
+            continue;
+        }
+        else
+        {
+            // A run of backed up pages is read as one sequential stream.
+            if (IS_MAP_RUN_START(flash_page_counter))
+                status = open_EEPROM_stream(eeprom_page_offset + flash_page_counter);
+
+            if (status == RETURN_CODE_SUCCESS)
+                status = read_EEPROM_stream(page_buffer, SPM_PAGESIZE);
+
+            if (status == RETURN_CODE_FAILURE || IS_MAP_RUN_END(flash_page_counter) ||
+                flash_page_counter + 1 == image_page_count)
+                close_EEPROM_stream();
+
+            if (status == RETURN_CODE_FAILURE)
+                return RETURN_CODE_FAILURE;
+        }
+
+        if (!is_flash_memory_page_equal(page_buffer, flash_page_counter))
+        {
+            write_to_flash_memory_page(page_buffer, flash_page_counter);
+            if (!is_flash_memory_page_equal(page_buffer, flash_page_counter))
+                return RETURN_CODE_FAILURE;
+
+            (*restored_page_count)++;
+        }
+
+        LED_PORT ^= _BV(BUILD_IN_LED_PIN);
+    }
+
+    return RETURN_CODE_SUCCESS;
+}
 #endif
 
 
 /**
-  Initlize the Application entry point pointer and call the pointer
-  to jump to the application.
+  Write the image of a firmware slot into the flash and read it back. Raw and
+  compressed images are read back against the CRC-32 of the image once all
+  pages are written, raw ones only with verify enabled; delta images and
+  differential backups are compared page by page.
+
+  Only a raw image resumes at first_page. The decoder of a compressed image
+  has to run from the start of the slot; the pages already written are
+  found equal and skipped.
+
+  @param[in]        eeprom_page_offset    First EEPROM page of the slot.
+  @param[in]        first_page            First flash page to copy.
+  @param[in]        image_header          Image header of the slot.
+  @param[in]        image_page_count      Number of pages of the image.
+  @param[in]        page_buffer           Buffer for one page.
+
+  @retval           RETURN_CODE_FAILURE   Flash does not hold the image.
+  @retval           RETURN_CODE_SUCCESS   Image written successfully.
 
 **/
-void jump_to_application()
+uint8_t program_image(uint16_t eeprom_page_offset, flash_page_t first_page, image_header_t *image_header,
+                      flash_page_t image_page_count, uint8_t *page_buffer)
 {
-    void (*start_app)(void) = (void (*)(void))APP_START_ADDRESS;
-    cli();
-    start_app();
+    uint8_t status = RETURN_CODE_SUCCESS;
+#if VERIFY_ENABLE || COMPRESSION_ENABLE
+    uint32_t image_checksum = image_header->checksum;
+#endif
+    flash_page_t page_count;
+
+#if !VERIFY_ENABLE && !COMPRESSION_ENABLE && !DIFF_BACKUP_ENABLE && !DELTA_ENABLE
+    (void)image_header;
+#endif
+
+#if DIFF_BACKUP_ENABLE
+    if (image_header->flags & IMAGE_FLAG_PAGE_MAP)
+    {
+        print_string("Restoring backed up pages ...\n");
+        status = restore_backup_pages(eeprom_page_offset, image_page_count, page_buffer, &page_count);
+
+        print_string("Pages restored: ");
+        print_number(page_count);
+        print_string("\n");
+
+        return status;
+    }
+#endif
+
+#if DELTA_ENABLE
+    if (image_header->flags & IMAGE_FLAG_DELTA)
+    {
+        print_string("Applying Patch ...\n");
+        open_EEPROM_stream(eeprom_page_offset);
+        status = patch_image_in_flash(page_buffer, &page_count);
+        close_EEPROM_stream();
+
+        print_string("Pages patched: ");
+        print_number(page_count);
+        print_string("\n");
+
+        return status;
+    }
+#endif
+
+    print_string("Pages to copy: ");
+    print_number(image_page_count);
+    print_string("\n");
+
+#if COMPRESSION_ENABLE
+    if (image_header->flags & IMAGE_FLAG_COMPRESSED)
+    {
+        open_EEPROM_stream(eeprom_page_offset);
+        status = decompress_image_to_flash(image_page_count, page_buffer, &page_count);
+        close_EEPROM_stream();
+
+        // The checksum covers the packed data, the decoded image has its CRC-32 in the base checksum.
+        image_checksum = image_header->base_checksum;
+    }
+    else
+#endif
+    page_count = copy_image_to_flash(eeprom_page_offset, first_page, image_page_count, page_buffer);
+
+#if VERIFY_ENABLE
+    if (status == RETURN_CODE_SUCCESS && image_header->magic == IMAGE_HEADER_MAGIC &&
+        get_flash_checksum(image_page_count, page_buffer) != image_checksum)
+        status = RETURN_CODE_FAILURE;
+#elif COMPRESSION_ENABLE
+    // The CRC of the slot covers the packed data, only the readback checks the decoded image.
+    if (status == RETURN_CODE_SUCCESS && (image_header->flags & IMAGE_FLAG_COMPRESSED) &&
+        get_flash_checksum(image_page_count, page_buffer) != image_checksum)
+        status = RETURN_CODE_FAILURE;
+#endif
+
+    print_string("Unchanged pages skipped: ");
+    print_number(page_count);
+    print_string("\n");
+
+    return status;
+}
+
+
+#if SERIAL_INGEST_ENABLE || BOOT_SERVICES_ENABLE
+
+/**
+  Write the image header of Slot 1 and a config which applies Slot 1 at the
+  next update check.
+
+  @param[in]        image_header          Image header of the data in Slot 1.
+  @param[out]       config_buffer         Buffer for the config.
+
+  @retval           RETURN_CODE_FAILURE   Header or config write failed.
+  @retval           RETURN_CODE_SUCCESS   Update enabled.
+
+**/
+uint8_t enable_slot_1_update(image_header_t *image_header, uint8_t *config_buffer)
+{
+    // Every page of Slot 1 is written here, no occupancy map follows the header.
+    image_header->flags &= ~IMAGE_FLAG_OCCUPANCY;
+    clear_fast_boot_hint();
+
+    if (write_to_EEPROM_page((uint8_t *)image_header, IMAGE_HEADER_PAGE(FIRMWARE_SLOT_1),
+                             sizeof(image_header_t)) == RETURN_CODE_FAILURE ||
+        read_config(config_buffer) == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+    config_buffer[FWU_MODE_ADDRESS]          = FWU_MODE_ENABLED;
+    config_buffer[FWU_SLOT_ADDRESS]          = FIRMWARE_SLOT_1;
+    config_buffer[FWU_RECOVERY_MODE_ADDRESS] = FWU_MODE_DISABLED;
+
+    return write_config(config_buffer);
+}
+#endif
+
+
+#if SERIAL_INGEST_ENABLE
+
+/**
+  Receive a firmware image over the UART into Slot 1. The host has to send a
+  hello frame within SERIAL_INGEST_WINDOW_MS, otherwise the boot goes on at
+  once. The host sends a frame only after the answer to the previous one, so
+  nothing arrives while the UART is not read. The hello is answered at once,
+  while the write which invalidates the Slot 1 header runs. A page frame is
+  answered when its page write has started; the write cycle runs while the
+  next frame arrives and is waited for after that frame. The end frame
+  carries the image header. It is written last, with a config which
+  applies Slot 1, so the update runs in this same boot.
+
+  @param[in]        page_buffer           Buffer of SPM_PAGESIZE bytes.
+  @param[out]       config_buffer         Buffer for the config.
+
+**/
+void ingest_serial_image(uint8_t *page_buffer, uint8_t *config_buffer)
+{
+    ingest_frame_t frame;
+    uint16_t header_magic = 0;
+    uint8_t status = RETURN_CODE_FAILURE;
+    uint8_t reply;
+
+    open_serial_ingest();
+
+    for(uint8_t tries = 0; ; tries++)
+    {
+        if (tries == SERIAL_INGEST_HELLO_TRIES ||
+            receive_ingest_frame(&frame, page_buffer, SERIAL_INGEST_WINDOW_MS) == RETURN_CODE_FAILURE)
+        {
+            close_serial_ingest();
+            return;
+        }
+
+        if (frame.type == SERIAL_INGEST_FRAME_HELLO)
+            break;
+    }
+
+    // A host repeats the hello every few ms, the answer must not wait for the write cycle.
+    start_EEPROM_page_write((uint8_t *)&header_magic, IMAGE_HEADER_PAGE(FIRMWARE_SLOT_1), sizeof(header_magic));
+    send_ingest_reply(&frame, SERIAL_INGEST_ACK);
+
+    while (status == RETURN_CODE_FAILURE &&
+           receive_ingest_frame(&frame, page_buffer, SERIAL_INGEST_TIMEOUT_MS) == RETURN_CODE_SUCCESS)
+    {
+        reply = SERIAL_INGEST_NAK;
+
+        // The answer to the hello got lost, the host repeats it.
+        if (frame.type == SERIAL_INGEST_FRAME_HELLO)
+            reply = SERIAL_INGEST_ACK;
+
+        if (frame.type == SERIAL_INGEST_FRAME_PAGE && frame.length == SPM_PAGESIZE &&
+            frame.page < FIRMWARE_MAX_PAGE &&
+            start_EEPROM_page_write(page_buffer, FIRMWARE_SLOT_1_PAGE_START + frame.page,
+                                    SPM_PAGESIZE) == RETURN_CODE_SUCCESS)
+            reply = SERIAL_INGEST_ACK;
+
+        if (frame.type == SERIAL_INGEST_FRAME_END && frame.length == sizeof(image_header_t) &&
+            wait_EEPROM_page_write() == RETURN_CODE_SUCCESS)
+        {
+            status = enable_slot_1_update((image_header_t *)page_buffer, config_buffer);
+            if (status == RETURN_CODE_SUCCESS)
+                reply = SERIAL_INGEST_ACK;
+        }
+
+        send_ingest_reply(&frame, reply);
+    }
+
+    wait_EEPROM_page_write();
+    close_serial_ingest();
+
+    if (status == RETURN_CODE_SUCCESS)
+        print_string("Firmware received over serial.\n");
+    else
+        print_string("Serial firmware transfer aborted.\n");
+}
+#endif
+
+
+#if BOOT_SERVICES_ENABLE
+
+/*
+Registers of the application which the drivers use during a service call.
+The drivers keep no state in RAM for a service call.
+*/
+
+typedef struct
+{
+    uint8_t  twbr;
+    uint8_t  twsr;
+    uint8_t  twcr;
+} boot_service_context_t;
+
+
+/**
+  Take the EEPROM bus for a service call of the application.
+
+  @param[out]       context               Application state to put back.
+
+**/
+void enter_boot_service(boot_service_context_t *context)
+{
+    context->twbr = TWBR;
+    context->twsr = TWSR;
+    context->twcr = TWCR;
+
+    init_EEPROM_bus();
+    update_EEPROM_bus(ENABLE);
+}
+
+
+/**
+  Hand the bus back to the application after a service call.
+
+  @param[in]        context               Application state saved by enter_boot_service().
+
+**/
+void leave_boot_service(boot_service_context_t *context)
+{
+    update_EEPROM_bus(DISABLE);
+
+    TWBR = context->twbr;
+    TWSR = context->twsr;
+    TWCR = context->twcr & ~(_BV(TWINT) | _BV(TWSTA) | _BV(TWSTO));    // No bus action on the write.
+}
+
+
+/**
+  Service: write one page of Slot 1. Page 0 starts a new image, so the image
+  header of the slot is invalidated first.
+
+  @param[in]        page_number           Page of the slot.
+  @param[in]        page_buffer           SPM_PAGESIZE bytes of the page.
+
+  @retval           RETURN_CODE_FAILURE   Page outside the slot or write failed.
+  @retval           RETURN_CODE_SUCCESS   Page written.
+
+**/
+uint8_t service_write_slot_page(uint8_t page_number, const uint8_t *page_buffer)
+{
+    boot_service_context_t context;
+    uint16_t header_magic = 0;
+    uint8_t status = RETURN_CODE_FAILURE;
+
+    if (page_number >= FIRMWARE_MAX_PAGE)
+        return RETURN_CODE_FAILURE;
+
+    enter_boot_service(&context);
+
+    if (page_number != 0 ||
+        write_to_EEPROM_page((uint8_t *)&header_magic, IMAGE_HEADER_PAGE(FIRMWARE_SLOT_1),
+                             sizeof(header_magic)) == RETURN_CODE_SUCCESS)
+        status = write_to_EEPROM_page((uint8_t *)page_buffer, FIRMWARE_SLOT_1_PAGE_START + page_number,
+                                      SPM_PAGESIZE);
+
+    leave_boot_service(&context);
+    return status;
+}
+
+
+/**
+  Service: compute the CRC-32 of the start of Slot 1.
+
+  @param[in]        length                Number of bytes from the start of the slot.
+  @param[out]       checksum              CRC-32 of the bytes.
+
+  @retval           RETURN_CODE_FAILURE   Length beyond the slot or read failed.
+  @retval           RETURN_CODE_SUCCESS   Checksum computed.
+
+**/
+uint8_t service_get_slot_checksum(uint16_t length, uint32_t *checksum)
+{
+    boot_service_context_t context;
+    uint8_t page_buffer[SPM_PAGESIZE];
+    uint8_t status;
+
+    enter_boot_service(&context);
+    status = read_slot_checksum(FIRMWARE_SLOT_1_PAGE_START, length, page_buffer, checksum);
+    leave_boot_service(&context);
+
+    return status;
+}
+
+
+/**
+  Service: check Slot 1 against an image header, then write the header and
+  enable the update for the next reset.
+
+  @param[in]        image_header          Header of the image in Slot 1.
+
+  @retval           RETURN_CODE_FAILURE   Slot does not match the header or write failed.
+  @retval           RETURN_CODE_SUCCESS   Update enabled.
+
+**/
+uint8_t service_commit_update(const image_header_t *image_header)
+{
+    boot_service_context_t context;
+    image_header_t header;
+    uint8_t page_buffer[SPM_PAGESIZE];
+    uint8_t status = RETURN_CODE_FAILURE;
+
+    memcpy(&header, image_header, sizeof(header));
+    if (header.magic != IMAGE_HEADER_MAGIC)
+        return RETURN_CODE_FAILURE;
+
+    enter_boot_service(&context);
+
+    // page_buffer holds the config after the check, CONFIG_PAGE_SIZE fits.
+    if (verify_slot_image(FIRMWARE_SLOT_1_PAGE_START, &header, page_buffer) == RETURN_CODE_SUCCESS)
+        status = enable_slot_1_update(&header, page_buffer);
+
+    leave_boot_service(&context);
+    return status;
+}
+
+
+/**
+  Service: confirm the running firmware. The default config is written, the
+  mirror slot is kept. Nothing is written when the
+  config is the default already.
+
+  @retval           RETURN_CODE_FAILURE   Config read or write failed.
+  @retval           RETURN_CODE_SUCCESS   Config is the default.
+
+**/
+uint8_t service_confirm_update()
+{
+    boot_service_context_t context;
+    uint8_t config_buffer[CONFIG_PAGE_SIZE];
+    uint8_t default_config[CONFIG_PAGE_SIZE];
+    uint8_t status;
+
+    enter_boot_service(&context);
+
+    status = read_config(config_buffer);
+    memcpy(default_config, config_buffer, CONFIG_PAGE_SIZE);
+    set_default_config(default_config);
+
+    if (status == RETURN_CODE_SUCCESS && memcmp(default_config, config_buffer, RING_RECORD_DATA_SIZE) != 0)
+        status = write_config(default_config);
+
+    leave_boot_service(&context);
+    return status;
 }
 
 
+// Service table at BOOT_SERVICES_ADDRESS, see boot_services.h.
+const boot_services_t boot_services BOOT_SERVICES_SECTION =
+{
+    BOOT_SERVICES_MAGIC,
+    BOOT_SERVICES_VERSION,
+    0,
+    service_write_slot_page,
+    service_get_slot_checksum,
+    service_commit_update,
+    service_confirm_update,
+};
+#endif
+
+
 /**
   Main function of the iBootLoader. This is the entry point for the bootloader.
 
 **/
 int main()
 {
-    uint16_t eeprom_page_counter;
-    uint8_t eeprom_page_offset;
-    uint8_t flash_page_counter;
+    uint16_t eeprom_page_offset;
+    flash_page_t image_page_count;
+    uint8_t source_slot;
+    uint8_t is_update;
+    uint8_t backup_mode;
+    flash_page_t resume_page;
+    image_header_t image_header;
     uint8_t page_buffer[SPM_PAGESIZE];
     uint8_t config_buffer[CONFIG_PAGE_SIZE];
 
+#if FAST_BOOT_ENABLE
+    fast_boot_hint_t fast_boot_hint;
+
+    /*
+    The last full boot found no update pending. A power-on skips the banner,
+    the serial ingest window and the config read, unless a config was written
+    since; the EEPROM bus is then hidden, as the normal boot leaves it for the
+    application.
+    */
+
+    if (is_fast_boot_allowed(&fast_boot_hint))
+    {
+        disable_watchdog_timer();
+        init_EEPROM_bus();
+        update_EEPROM_bus(ENABLE);
+
+        if (is_config_unchanged(&fast_boot_hint))
+        {
+            update_EEPROM_bus(DISABLE);
+            jump_to_application();
+        }
+    }
+#endif
+
+    start_boot_timing();
     disable_watchdog_timer();
     serial_setup();
     LED_DDR |= _BV(BUILD_IN_LED_PIN);
@@ -105,9 +1683,14 @@ int main()
     print_string(VERSION);
     print_string("  :~~~~~~~~\n");
 
+    BOOT_PHASE(BOOT_PHASE_CONFIG);
     update_EEPROM_bus(ENABLE);
 
-    if (read_from_EEPROM_page(config_buffer, CONFIG_PAGE_NUMBER, CONFIG_PAGE_SIZE) == RETURN_CODE_SUCCESS)
+#if SERIAL_INGEST_ENABLE
+    ingest_serial_image(page_buffer, config_buffer);
+#endif
+
+    if (read_config(config_buffer) == RETURN_CODE_SUCCESS)
     {
 
         if(config_buffer[FWU_MODE_ADDRESS] != FWU_MODE_ENABLED && \
@@ -115,45 +1698,32 @@ int main()
         {
             print_string("FWU Mode Unknown; Turn it False.\n");
             config_buffer[FWU_MODE_ADDRESS] = FWU_MODE_DISABLED;
-            write_to_EEPROM_page(config_buffer, CONFIG_PAGE_NUMBER, CONFIG_PAGE_SIZE);
-            _delay_ms(EEPROM_WRITE_DELAY);
+            write_config(config_buffer);
         }
 
-        read_from_EEPROM_page(config_buffer, CONFIG_PAGE_NUMBER, CONFIG_PAGE_SIZE);
-
         if(config_buffer[FWU_MODE_ADDRESS] == FWU_MODE_ENABLED)
         {
-            if(config_buffer[FWU_BKUP_MODE_ADDRESS] != FWU_MODE_DISABLED)
-            {
-                print_string("Old Firmware Backing up ...\n");
+            // Any boot until the update is confirmed has to read the config.
+            clear_fast_boot_hint();
 
-                for(flash_page_counter = 0, eeprom_page_counter = FIRMWARE_MAX_PAGE;
-                    flash_page_counter < FIRMWARE_MAX_PAGE;
-                    flash_page_counter++, eeprom_page_counter++)
-                {
-                    read_from_flash_memory_page(page_buffer, flash_page_counter);
-
-                    write_to_EEPROM_page(page_buffer, eeprom_page_counter, SPM_PAGESIZE);
-                    _delay_ms(EEPROM_WRITE_DELAY);
-
-                    LED_PORT ^= _BV(BUILD_IN_LED_PIN);
-                }
-            }
+            backup_mode        = config_buffer[FWU_BKUP_MODE_ADDRESS];
+            source_slot        = FWU_SOURCE_SLOT(config_buffer);
+            eeprom_page_offset = SLOT_PAGE_START(source_slot);
+            is_update          = !FWU_IS_ROLLBACK(config_buffer);
 
-            if (config_buffer[FWU_SLOT_ADDRESS] == FIRMWARE_SLOT_2)
+            if (!is_update)
             {
-                print_string("Recovering Old Firmware from Slot 2 ...\n");
-                eeprom_page_offset = FIRMWARE_MAX_PAGE;
+                print_string("Recovering Old Firmware from Slot ");
+                print_number(source_slot);
+                print_string(" ...\n");
 
-                config_buffer[FWU_MODE_ADDRESS]          = FWU_MODE_DISABLED;
-                config_buffer[FWU_SLOT_ADDRESS]          = FIRMWARE_SLOT_1;
-                config_buffer[FWU_BKUP_MODE_ADDRESS]     = FWU_MODE_ENABLED;
-                config_buffer[FWU_RECOVERY_MODE_ADDRESS] = FWU_MODE_DISABLED;
+                set_default_config(config_buffer);
             }
             else
             {
-                print_string("New Firmware Updating from Slot 1 ...\n");
-                eeprom_page_offset = 0;
+                print_string("New Firmware Updating from Slot ");
+                print_number(source_slot);
+                print_string(" ...\n");
 
                 /*
                 BootLoader will keep the fwu_enable_mode ENABLE as well as It sets
@@ -166,37 +1736,133 @@ int main()
                 */
 
                 config_buffer[FWU_MODE_ADDRESS]          = FWU_MODE_ENABLED; // Not Needed; only for code readability
-                config_buffer[FWU_SLOT_ADDRESS]          = FIRMWARE_SLOT_2;
+                config_buffer[FWU_SLOT_ADDRESS]          = OTHER_SLOT(source_slot);
                 config_buffer[FWU_BKUP_MODE_ADDRESS]     = FWU_MODE_DISABLED;
                 config_buffer[FWU_RECOVERY_MODE_ADDRESS] = FWU_MODE_ENABLED;
             }
 
-            for(flash_page_counter = 0, eeprom_page_counter = eeprom_page_offset;
-                eeprom_page_counter < (uint16_t)(FIRMWARE_MAX_PAGE + eeprom_page_offset);
-                flash_page_counter++, eeprom_page_counter++)
+            BOOT_PHASE(BOOT_PHASE_VERIFY);
+            image_page_count = read_image_header(source_slot, &image_header);
+#if OCCUPANCY_MAP_ENABLE
+            read_occupancy_map(source_slot, &image_header, page_buffer);
+#endif
+
+#if JOURNAL_ENABLE
+            /*
+            An open journal means the flash copy was interrupted, e.g. by a power
+            loss. The flash is then partly written and must not be backed up.
+            */
+
+            resume_page = read_journal(source_slot, &image_header);
+            if (resume_page != JOURNAL_NOT_STARTED)
+            {
+                print_string("Resuming interrupted update at page: ");
+                print_number(resume_page);
+                print_string("\n");
+            }
+#else
+            resume_page = JOURNAL_NOT_STARTED;
+#endif
+
+            /*
+            The image is checked before the first flash page is erased, a broken
+            upload leaves the running firmware and the backup untouched. A
+            recovery or a resumed copy relies on the readback instead.
+            */
+
+            if (is_image_applicable(eeprom_page_offset, &image_header,
+                                    is_update && resume_page == JOURNAL_NOT_STARTED,
+                                    page_buffer) == RETURN_CODE_FAILURE)
             {
-                read_from_EEPROM_page(page_buffer, eeprom_page_counter, SPM_PAGESIZE);
+                if (resume_page != JOURNAL_NOT_STARTED && is_update)
+                {
+                    // Flash is partly written, e.g. by a delta image; let the recovery restore the other slot.
+                    print_string("Interrupted update can not be resumed; Recovering.\n");
+                    write_config(config_buffer);
+#if JOURNAL_ENABLE
+                    clear_journal();
+#endif
+                    flush_serial_output();
+                    reset_by_watchdog_timer();
+                }
 
-                write_to_flash_memory_page(page_buffer, flash_page_counter);
-                LED_PORT ^= _BV(BUILD_IN_LED_PIN);
+                print_string("Firmware Image can not be applied; Update Skipped.\n");
+
+                set_default_config(config_buffer);
+                write_config(config_buffer);
             }
+            else
+            {
+                if (resume_page == JOURNAL_NOT_STARTED && is_update &&
+                    backup_mode != FWU_MODE_DISABLED)
+                {
+                    BOOT_PHASE(BOOT_PHASE_BACKUP);
+#if AB_SLOTS_ENABLE
+                    // The other slot still holds the image the flash was programmed from.
+                    if (is_mirror_slot(OTHER_SLOT(source_slot), config_buffer, page_buffer) == RETURN_CODE_SUCCESS)
+                        print_string("Running Firmware is mirrored in the other Slot; Backup Skipped.\n");
+                    else
+#endif
+                    backup_flash_to_slot(OTHER_SLOT(source_slot), page_buffer);
+                }
+
+                BOOT_PHASE(BOOT_PHASE_PROGRAM);
+                if (resume_page == JOURNAL_NOT_STARTED || resume_page == 0)
+                {
+                    resume_page = 0;
+#if JOURNAL_ENABLE
+                    start_journal(source_slot, &image_header);
+#endif
+                }
+
+                uint8_t status = program_image(eeprom_page_offset, resume_page, &image_header,
+                                               image_page_count, page_buffer);
+
+                // The config goes first; a power loss in between ends in the recovery, not in a backup of the new image.
+                BOOT_PHASE(BOOT_PHASE_COMMIT);
+#if AB_SLOTS_ENABLE
+                // A patch or packed image in the source slot can not restore the flash later.
+                config_buffer[FWU_MIRROR_SLOT_ADDRESS] = (status == RETURN_CODE_SUCCESS &&
+                                                          !(image_header.flags & IMAGE_FLAGS_NOT_MIRROR)) ?
+                                                         source_slot : CONFIG_BLANK;
+#endif
+                write_config(config_buffer);
+#if JOURNAL_ENABLE
+                clear_journal();
+#endif
+
+                if (status == RETURN_CODE_FAILURE)
+                {
+                    print_string("Firmware readback failed.\n");
 
-            write_to_EEPROM_page(config_buffer, CONFIG_PAGE_NUMBER, CONFIG_PAGE_SIZE);
-            _delay_ms(EEPROM_WRITE_DELAY);
+                    if (is_update)
+                    {
+                        // Flash is partly written, reset now and let the recovery restore the other slot.
+                        print_string("Recovering.\n");
+                        flush_serial_output();
+                        reset_by_watchdog_timer();
+                    }
+                }
 
-            print_string("WDT Activated.\n");
-            enable_watchdog_timer(WATCHDOG_1S);
-            print_string("Firmware update completed.\n");
+                print_string("WDT Activated.\n");
+                enable_watchdog_timer(WATCHDOG_1S);
+                print_string("Firmware update completed.\n");
+            }
         }
         else
         {
             print_string("No Firmware Update Available.\n");
+#if FAST_BOOT_ENABLE
+            update_fast_boot_hint();
+#endif
         }
     }
     else
     {
         print_string("Not able to read FWU EEPROM\n");
     }
+
+    BOOT_PHASE(BOOT_PHASE_JUMP);
     update_EEPROM_bus(DISABLE);
 
     print_string("Jumping to the application ...\n\n");
@@ -44,7 +44,25 @@
 #define RETURN_CODE_SUCCESS  0
 #define RETURN_CODE_FAILURE  1
 
-#define EEPROM_WRITE_DELAY   5
+#define I2C_ACK_POLL_MAX     1000
+
+// Phases of the boot, marked with BOOT_PHASE(); the marks are empty unless boot timing is enabled or a build
+// defines BOOT_PHASE.
+#define BOOT_PHASE_CONFIG    1
+#define BOOT_PHASE_VERIFY    2
+#define BOOT_PHASE_BACKUP    3
+#define BOOT_PHASE_PROGRAM   4
+#define BOOT_PHASE_COMMIT    5
+#define BOOT_PHASE_JUMP      6
+#define BOOT_PHASE_COUNT     7
+
+#ifndef BOOT_PHASE
+#if BOOT_TIMING_ENABLE
+#define BOOT_PHASE(phase)    mark_boot_phase(phase)
+#else
+#define BOOT_PHASE(phase)
+#endif
+#endif
 
 #define LED_DDR              DDRD
 #define LED_PORT             PORTD
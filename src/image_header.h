@@ -0,0 +1,123 @@
+/**
+  @file
+  iBootLoader - image_header.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef IMAGE_HEADER_H
+#define IMAGE_HEADER_H
+
+#define IMAGE_HEADER_MAGIC       0x4269  // "iB"
+
+#define IMAGE_FLAG_COMPRESSED    0x01    // Slot holds the image packed by lz_lite
+#define IMAGE_FLAG_DELTA         0x02    // Slot holds a patch against the running image
+#define IMAGE_FLAG_PAGE_MAP      0x04    // Slot holds only the backed up pages of the page map
+#define IMAGE_FLAG_OCCUPANCY     0x08    // Slot holds only the pages set in the occupancy map
+
+#define IMAGE_FLAGS_NOT_MIRROR   (IMAGE_FLAG_COMPRESSED | IMAGE_FLAG_DELTA | IMAGE_FLAG_PAGE_MAP)  // Slot can not be copied back as is
+
+#define IMAGE_OCCUPANCY_OFFSET   32      // Occupancy map offset in the image header page
+
+#if COMPRESSION_ENABLE
+#define IMAGE_FLAG_COMPRESSED_SUPPORTED IMAGE_FLAG_COMPRESSED
+#else
+#define IMAGE_FLAG_COMPRESSED_SUPPORTED 0
+#endif
+
+#if DELTA_ENABLE
+#define IMAGE_FLAG_DELTA_SUPPORTED      IMAGE_FLAG_DELTA
+#else
+#define IMAGE_FLAG_DELTA_SUPPORTED      0
+#endif
+
+#if DIFF_BACKUP_ENABLE
+#define IMAGE_FLAG_PAGE_MAP_SUPPORTED   IMAGE_FLAG_PAGE_MAP
+#else
+#define IMAGE_FLAG_PAGE_MAP_SUPPORTED   0
+#endif
+
+#if OCCUPANCY_MAP_ENABLE
+#define IMAGE_FLAG_OCCUPANCY_SUPPORTED  IMAGE_FLAG_OCCUPANCY
+#else
+#define IMAGE_FLAG_OCCUPANCY_SUPPORTED  0
+#endif
+
+#define IMAGE_SUPPORTED_FLAGS    (IMAGE_FLAG_COMPRESSED_SUPPORTED | IMAGE_FLAG_DELTA_SUPPORTED | \
+                                  IMAGE_FLAG_PAGE_MAP_SUPPORTED | IMAGE_FLAG_OCCUPANCY_SUPPORTED)
+
+/*
+  A delta image is a list of page records, ended by DELTA_END_PAGE:
+
+    page number                 1 byte
+    keep count, literal count   1 byte each, repeated until the page is covered
+    literal bytes               literal count bytes after each count pair
+
+  Keep bytes are taken from the running flash page, literal bytes from the
+  patch. Pages without a record are left as they are.
+*/
+
+#define DELTA_END_PAGE           0xFF
+
+
+/**
+  Firmware image header. One header is kept for every firmware slot in the
+  EEPROM config region and is written by manage_fwu_eeprom.py when an image
+  is uploaded, or by the bootloader when it backs up the flash.
+
+  The image length is a multiple of SPM_PAGESIZE, the host pads the image
+  with 0xFF. The stored length is the amount of data in the slot, which is
+  smaller than the image length for compressed images. The checksum is the
+  CRC-32 of the stored data. For delta images the base checksum is the CRC-32
+  of the whole application flash area the patch has to be applied on, for
+  compressed images the CRC-32 of the decoded image, checked once it is in
+  the flash.
+
+  A differential backup keeps the pages of its page map at their place in
+  the slot. Its checksum covers the page map and then the backed up pages,
+  its base checksum the flash pages outside the map, which a restore leaves
+  as they are.
+
+  A raw image with an occupancy map leaves its blank pages out of the slot.
+  The map follows the header at IMAGE_OCCUPANCY_OFFSET, one bit per page,
+  set for the pages which hold data. The checksum still covers the whole
+  image, blank pages count as 0xFF.
+
+**/
+typedef struct
+{
+    uint16_t magic;
+    uint16_t length;
+    uint32_t checksum;
+    uint8_t  version_major;
+    uint8_t  version_minor;
+    uint8_t  version_patch;
+    uint8_t  flags;
+    uint16_t version_build;
+    uint16_t stored_length;
+    uint32_t base_checksum;
+} image_header_t;
+
+#endif //IMAGE_HEADER_H
@@ -0,0 +1,111 @@
+/**
+  @file
+  iBootLoader - lz_lite.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <string.h>
+
+#include "lz_lite.h"
+#include "eeprom_read_write.h"
+#include "ialoy_code.h"
+#include "target_profile.h"
+
+
+/**
+  Reset the decoder to the start of an image.
+
+  @param[out]       state                 Decoder state.
+
+**/
+void lz_lite_init(lz_lite_state_t *state)
+{
+    memset(state, 0, sizeof(lz_lite_state_t));
+}
+
+
+/**
+  Decode the next SPM_PAGESIZE bytes of a compressed image from the open
+  EEPROM read stream. Back references which reach before the current page
+  are read from flash, which already holds the decoded pages, so the decoder
+  needs no window buffer in RAM. The previous pages must be written and the
+  RWW section enabled before the call.
+
+  @param[in out]    state                 Decoder state.
+  @param[out]       page_buffer           Buffer pointer to get the page.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read the compressed data.
+  @retval           RETURN_CODE_SUCCESS   Page decoded successfully.
+
+**/
+uint8_t lz_lite_decode_page(lz_lite_state_t *state, uint8_t *page_buffer)
+{
+    uint16_t page_start = state->position;
+    uint16_t source;
+    uint8_t data[2];
+
+    for(uint16_t i = 0; i < SPM_PAGESIZE; i++)
+    {
+        if (state->match_length == 0)
+        {
+            if (state->flag_count == 0)
+            {
+                if (read_EEPROM_stream(&state->flags, 1) == RETURN_CODE_FAILURE)
+                    return RETURN_CODE_FAILURE;
+                state->flag_count = 8;
+            }
+
+            state->flag_count--;
+            if (state->flags & 1)
+            {
+                state->flags >>= 1;
+                if (read_EEPROM_stream(&page_buffer[i], 1) == RETURN_CODE_FAILURE)
+                    return RETURN_CODE_FAILURE;
+                state->position++;
+                continue;
+            }
+            state->flags >>= 1;
+
+            if (read_EEPROM_stream(data, 2) == RETURN_CODE_FAILURE)
+                return RETURN_CODE_FAILURE;
+            state->match_distance = (data[0] | ((uint16_t)(data[1] & 0xF0) << 4)) + 1;
+            state->match_length   = (data[1] & 0x0F) + LZ_LITE_MIN_MATCH;
+        }
+
+        source = state->position - state->match_distance;
+        if (source >= page_start)
+            page_buffer[i] = page_buffer[source - page_start];
+        else
+            page_buffer[i] = read_flash_byte(source);
+
+        state->position++;
+        state->match_length--;
+    }
+
+    return RETURN_CODE_SUCCESS;
+}
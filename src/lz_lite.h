@@ -0,0 +1,84 @@
+/**
+  @file
+  iBootLoader - lz_lite.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef LZ_LITE_H
+#define LZ_LITE_H
+
+/*
+  Compressed images use LZSS. Every flag byte is followed by 8 items, one per
+  flag bit starting from the LSB. A set bit is a literal byte, a clear bit is
+  a back reference of two bytes:
+
+    byte 0      low 8 bits of (distance - 1)
+    byte 1      high 4 bits of (distance - 1) << 4 | (length - LZ_LITE_MIN_MATCH)
+
+  which copies length bytes from distance bytes back in the decoded image.
+*/
+
+#define LZ_LITE_MIN_MATCH     3
+#define LZ_LITE_MAX_MATCH     (LZ_LITE_MIN_MATCH + 15)
+#define LZ_LITE_WINDOW_SIZE   4096
+
+
+typedef struct
+{
+    uint16_t position;        // Decoded bytes so far
+    uint16_t match_distance;  // Distance of the pending back reference
+    uint8_t  match_length;    // Bytes left of the pending back reference
+    uint8_t  flags;           // Flag bits not used yet
+    uint8_t  flag_count;      // Number of flag bits not used yet
+} lz_lite_state_t;
+
+
+/**
+  Reset the decoder to the start of an image.
+
+  @param[out]       state                 Decoder state.
+
+**/
+void lz_lite_init(lz_lite_state_t *state);
+
+
+/**
+  Decode the next SPM_PAGESIZE bytes of a compressed image from the open
+  EEPROM read stream. Back references which reach before the current page
+  are read from flash, which already holds the decoded pages, so the decoder
+  needs no window buffer in RAM. The previous pages must be written and the
+  RWW section enabled before the call.
+
+  @param[in out]    state                 Decoder state.
+  @param[out]       page_buffer           Buffer pointer to get the page.
+
+  @retval           RETURN_CODE_FAILURE   Failed to read the compressed data.
+  @retval           RETURN_CODE_SUCCESS   Page decoded successfully.
+
+**/
+uint8_t lz_lite_decode_page(lz_lite_state_t *state, uint8_t *page_buffer);
+
+#endif //LZ_LITE_H
@@ -0,0 +1,219 @@
+/**
+  @file
+  iBootLoader - record_ring.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <avr/io.h>
+#include <string.h>
+
+#include "record_ring.h"
+#include "eeprom_read_write.h"
+#include "crc_lite.h"
+#include "ialoy_code.h"
+
+
+/**
+  Compute the check byte of a record.
+
+  @param[in]        record                Record to check.
+  @param[in]        record_size           Size of the record.
+
+  @retval           uint8_t               Check byte of the record.
+
+**/
+static uint8_t get_ring_record_check(const uint8_t *record, uint8_t record_size)
+{
+    return (uint8_t)crc_lite_update(0, record, record_size - 1);
+}
+
+
+/**
+  Find the newest record in some pages of a ring, read as one sequential
+  stream.
+
+  @param[in]        first_page            First EEPROM page of the ring.
+  @param[in]        page                  First ring page to read.
+  @param[in]        page_count            Number of pages to read.
+  @param[out]       record                Buffer for the newest record.
+  @param[in]        record_size           Size of a record of the ring.
+  @param[out]       record_index          Optional, index of the newest record in the ring.
+
+  @retval           RETURN_CODE_FAILURE   Pages hold no valid record.
+  @retval           RETURN_CODE_SUCCESS   Newest record found.
+
+**/
+static uint8_t scan_ring_pages(uint16_t first_page, uint8_t page, uint8_t page_count, void *record,
+                               uint8_t record_size, uint16_t *record_index)
+{
+    uint8_t candidate[RING_RECORD_MAX_SIZE];
+    uint16_t first_index = page * (SPM_PAGESIZE / record_size);
+    uint16_t record_count = page_count * (SPM_PAGESIZE / record_size);
+    uint8_t status = RETURN_CODE_FAILURE;
+
+    if (open_EEPROM_stream(first_page + page) == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+    for(uint16_t index = 0; index < record_count; index++)
+    {
+        if (read_EEPROM_stream(candidate, record_size) == RETURN_CODE_FAILURE)
+        {
+            status = RETURN_CODE_FAILURE;
+            break;
+        }
+
+        if (candidate[record_size - 1] != get_ring_record_check(candidate, record_size))
+            continue;
+
+        // Sequence numbers wrap, the ring never holds more than half of them.
+        if (status == RETURN_CODE_FAILURE || (int16_t)(*(uint16_t *)candidate - *(uint16_t *)record) > 0)
+        {
+            memcpy(record, candidate, record_size);
+            if (record_index)
+                *record_index = first_index + index;
+            status = RETURN_CODE_SUCCESS;
+        }
+    }
+
+    close_EEPROM_stream();
+    return status;
+}
+
+
+/**
+  Find the current record of a ring.
+
+  Records are appended in ring order, so the first records of the pages from
+  page 0 up to the page of the current record carry rising sequence numbers,
+  the pages after it hold older or no valid records. A binary search over the
+  first records finds that page, only its records are read. A ring without a
+  valid first record, empty or torn there by a write, is read as a whole.
+
+  @param[in]        first_page            First EEPROM page of the ring.
+  @param[in]        page_count            Number of pages of the ring.
+  @param[out]       record                Buffer for the current record.
+  @param[in]        record_size           Size of a record of the ring.
+  @param[out]       record_index          Optional, index of the current record.
+
+  @retval           RETURN_CODE_FAILURE   Ring holds no valid record.
+  @retval           RETURN_CODE_SUCCESS   Current record found.
+
+**/
+uint8_t find_ring_record(uint16_t first_page, uint8_t page_count, void *record, uint8_t record_size,
+                         uint16_t *record_index)
+{
+    uint8_t candidate[RING_RECORD_MAX_SIZE];
+    uint16_t first_sequence;
+    uint8_t low = 0;
+    uint8_t high = page_count - 1;
+    uint8_t middle;
+
+    if (read_from_EEPROM_page(candidate, first_page, record_size) == RETURN_CODE_FAILURE)
+        return RETURN_CODE_FAILURE;
+
+    if (candidate[record_size - 1] != get_ring_record_check(candidate, record_size))
+        return scan_ring_pages(first_page, 0, page_count, record, record_size, record_index);
+
+    first_sequence = *(uint16_t *)candidate;
+    while (low < high)
+    {
+        middle = (low + high + 1) / 2;
+
+        if (read_from_EEPROM_page(candidate, first_page + middle, record_size) == RETURN_CODE_FAILURE)
+            return RETURN_CODE_FAILURE;
+
+        if (candidate[record_size - 1] == get_ring_record_check(candidate, record_size) &&
+            (int16_t)(*(uint16_t *)candidate - first_sequence) >= 0)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+
+    return scan_ring_pages(first_page, low, 1, record, record_size, record_index);
+}
+
+
+/**
+  Read one record of a ring by its index.
+
+  @param[in]        first_page            First EEPROM page of the ring.
+  @param[in]        record_index          Index of the record in the ring.
+  @param[out]       record                Buffer for the record.
+  @param[in]        record_size           Size of a record of the ring.
+
+  @retval           RETURN_CODE_FAILURE   Read failed or the record is not valid.
+  @retval           RETURN_CODE_SUCCESS   Valid record read.
+
+**/
+uint8_t read_ring_record(uint16_t first_page, uint16_t record_index, void *record, uint8_t record_size)
+{
+    uint8_t records_per_page = SPM_PAGESIZE / record_size;
+
+    if (read_from_EEPROM_page_offset((uint8_t *)record, first_page + record_index / records_per_page,
+                                     (record_index % records_per_page) * record_size,
+                                     record_size) == RETURN_CODE_FAILURE ||
+        ((uint8_t *)record)[record_size - 1] != get_ring_record_check((uint8_t *)record, record_size))
+        return RETURN_CODE_FAILURE;
+
+    return RETURN_CODE_SUCCESS;
+}
+
+
+/**
+  Append a record to a ring, after the current record. The sequence number
+  and the check byte are filled in.
+
+  @param[in]        first_page            First EEPROM page of the ring.
+  @param[in]        page_count            Number of pages of the ring.
+  @param[in out]    record                Record to append.
+  @param[in]        record_size           Size of a record of the ring.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Record written successfully.
+
+**/
+uint8_t append_ring_record(uint16_t first_page, uint8_t page_count, void *record, uint8_t record_size)
+{
+    uint8_t current[RING_RECORD_MAX_SIZE];
+    uint8_t records_per_page = SPM_PAGESIZE / record_size;
+    uint16_t index;
+
+    if (find_ring_record(first_page, page_count, current, record_size, &index) == RETURN_CODE_SUCCESS)
+    {
+        *(uint16_t *)record = *(uint16_t *)current + 1;
+        index = (index + 1) % (page_count * records_per_page);
+    }
+    else
+    {
+        *(uint16_t *)record = 0;
+        index = 0;
+    }
+
+    ((uint8_t *)record)[record_size - 1] = get_ring_record_check((uint8_t *)record, record_size);
+
+    return write_to_EEPROM_page_offset((uint8_t *)record, first_page + index / records_per_page,
+                                       (index % records_per_page) * record_size, record_size);
+}
@@ -0,0 +1,107 @@
+/**
+  @file
+  iBootLoader - record_ring.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef RECORD_RING_H
+#define RECORD_RING_H
+
+#include <stddef.h>
+
+#define RING_RECORD_MAX_SIZE        16
+
+#define RING_RECORD_SIZE            8
+#define RING_RECORD_DATA_SIZE       5
+#define RING_RECORDS_PER_PAGE       (SPM_PAGESIZE / RING_RECORD_SIZE)
+
+
+/*
+Append only ring of small records in the EEPROM. Every record starts with a
+16 bit sequence number and ends with a check byte, the valid record with the
+highest sequence number is the current one. A new record is written after the
+current one, so a commit is one short write and a torn write leaves the
+previous record. The record size divides SPM_PAGESIZE and is at most
+RING_RECORD_MAX_SIZE; ring_record_t is the record of the config ring.
+*/
+
+typedef struct
+{
+    uint16_t sequence;
+    uint8_t  data[RING_RECORD_DATA_SIZE];
+    uint8_t  check;                         // Low byte of the CRC-32 of the record.
+} ring_record_t;
+
+
+/**
+  Find the current record of a ring. The first record of some pages and the
+  page of the current record are read, not the whole ring.
+
+  @param[in]        first_page            First EEPROM page of the ring.
+  @param[in]        page_count            Number of pages of the ring.
+  @param[out]       record                Buffer for the current record.
+  @param[in]        record_size           Size of a record of the ring.
+  @param[out]       record_index          Optional, index of the current record.
+
+  @retval           RETURN_CODE_FAILURE   Ring holds no valid record.
+  @retval           RETURN_CODE_SUCCESS   Current record found.
+
+**/
+uint8_t find_ring_record(uint16_t first_page, uint8_t page_count, void *record, uint8_t record_size,
+                         uint16_t *record_index = NULL);
+
+
+/**
+  Read one record of a ring by its index.
+
+  @param[in]        first_page            First EEPROM page of the ring.
+  @param[in]        record_index          Index of the record in the ring.
+  @param[out]       record                Buffer for the record.
+  @param[in]        record_size           Size of a record of the ring.
+
+  @retval           RETURN_CODE_FAILURE   Read failed or the record is not valid.
+  @retval           RETURN_CODE_SUCCESS   Valid record read.
+
+**/
+uint8_t read_ring_record(uint16_t first_page, uint16_t record_index, void *record, uint8_t record_size);
+
+
+/**
+  Append a record to a ring, after the current record. The sequence number
+  and the check byte are filled in.
+
+  @param[in]        first_page            First EEPROM page of the ring.
+  @param[in]        page_count            Number of pages of the ring.
+  @param[in out]    record                Record to append.
+  @param[in]        record_size           Size of a record of the ring.
+
+  @retval           RETURN_CODE_FAILURE   Write cycle did not complete in time.
+  @retval           RETURN_CODE_SUCCESS   Record written successfully.
+
+**/
+uint8_t append_ring_record(uint16_t first_page, uint8_t page_count, void *record, uint8_t record_size);
+
+#endif //RECORD_RING_H
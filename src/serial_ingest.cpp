@@ -0,0 +1,231 @@
+/**
+  @file
+  iBootLoader - serial_ingest.cpp
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#include <avr/io.h>
+#include <util/delay.h>
+
+#include "serial_ingest.h"
+#include "serial_lite.h"
+#include "crc_lite.h"
+#include "ialoy_code.h"
+
+#if SERIAL_INGEST_ENABLE
+
+// A byte takes 20 us at 500 kBaud, polling every 10 us keeps the 2 byte receive buffer from overrunning.
+#define SERIAL_INGEST_POLL_US         10
+#define SERIAL_INGEST_POLLS_PER_MS    (1000 / SERIAL_INGEST_POLL_US)
+
+
+/**
+  Wait for one received byte.
+
+  @param[out]       data                  Buffer for the byte.
+  @param[in out]    polls                 Polls left, shared by a run of calls.
+
+  @retval           RETURN_CODE_FAILURE   No byte received in time.
+  @retval           RETURN_CODE_SUCCESS   Byte received.
+
+**/
+static uint8_t receive_ingest_byte(uint8_t *data, uint32_t *polls)
+{
+    for(; *polls > 0; (*polls)--)
+    {
+        if (UCSR0A & _BV(RXC0))
+        {
+            *data = UDR0;
+            return RETURN_CODE_SUCCESS;
+        }
+
+        _delay_us(SERIAL_INGEST_POLL_US);
+    }
+
+    return RETURN_CODE_FAILURE;
+}
+
+
+/**
+  Wait for one byte inside a frame.
+
+  @param[out]       data                  Buffer for the byte.
+
+  @retval           RETURN_CODE_FAILURE   No byte received in time.
+  @retval           RETURN_CODE_SUCCESS   Byte received.
+
+**/
+static uint8_t receive_ingest_frame_byte(uint8_t *data)
+{
+    uint32_t polls = SERIAL_INGEST_BYTE_TIMEOUT_MS * SERIAL_INGEST_POLLS_PER_MS;
+
+    return receive_ingest_byte(data, &polls);
+}
+
+
+/**
+  Drop the rest of a bad frame. Bytes are read until the line is idle, at
+  most one frame long, so the NAK does not overlap the tail of the frame and
+  the repeat starts on an empty receive buffer.
+
+  @param[out]       frame                 Frame to mark invalid.
+
+  @retval           RETURN_CODE_SUCCESS   Frame received, as invalid.
+
+**/
+static uint8_t reject_ingest_frame(ingest_frame_t *frame)
+{
+    uint8_t data;
+
+    for(uint16_t i = 0; i < 4 + SPM_PAGESIZE + 4 && receive_ingest_frame_byte(&data) == RETURN_CODE_SUCCESS; i++);
+
+    frame->type = SERIAL_INGEST_FRAME_INVALID;
+    return RETURN_CODE_SUCCESS;
+}
+
+
+/**
+  Switch the UART to SERIAL_INGEST_BAUD. Pending serial output is sent first
+  at the boot baud rate.
+
+**/
+void open_serial_ingest()
+{
+    uint8_t data;
+
+    flush_serial_output();
+    _delay_us(100);                         // Last byte leaves the shift register.
+
+    UCSR0B = 0;
+    UCSR0A = _BV(U2X0);
+    UBRR0H = (uint8_t)(SERIAL_INGEST_UBRR >> 8);
+    UBRR0L = (uint8_t)SERIAL_INGEST_UBRR;
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+    UCSR0B = _BV(RXEN0) | _BV(TXEN0);
+
+    // Drop what was received at the old baud rate.
+    while (UCSR0A & _BV(RXC0))
+        data = UDR0;
+    (void)data;
+}
+
+
+/**
+  Switch the UART back to the boot baud rate, or off if serial output is
+  disabled.
+
+**/
+void close_serial_ingest()
+{
+    while (!(UCSR0A & _BV(UDRE0)));
+    _delay_us(20);                          // Last reply leaves the shift register.
+
+    UCSR0B = 0;
+    UCSR0A = 0;
+    UBRR0H = 0;
+    UBRR0L = 0;
+    UCSR0C = _BV(UCSZ01) | _BV(UCSZ00);
+    serial_setup();
+}
+
+
+/**
+  Receive one frame. A frame with a bad CRC or length is returned as
+  SERIAL_INGEST_FRAME_INVALID. The CRC is updated with every byte, nothing
+  takes longer than a byte time while the frame is on the line.
+
+  @param[out]       frame                 Type, page and payload length of the frame.
+  @param[out]       payload               Buffer of SPM_PAGESIZE bytes for the payload.
+  @param[in]        timeout_ms            Time to wait for the start of the frame.
+
+  @retval           RETURN_CODE_FAILURE   No frame started in time.
+  @retval           RETURN_CODE_SUCCESS   Frame received.
+
+**/
+uint8_t receive_ingest_frame(ingest_frame_t *frame, uint8_t *payload, uint16_t timeout_ms)
+{
+    uint32_t polls = (uint32_t)timeout_ms * SERIAL_INGEST_POLLS_PER_MS;
+    uint32_t received_checksum = 0;
+    uint32_t checksum;
+    uint8_t data = 0;
+
+    // The timeout covers the whole search, noise on the line can not hold the boot.
+    do
+    {
+        if (receive_ingest_byte(&data, &polls) == RETURN_CODE_FAILURE)
+            return RETURN_CODE_FAILURE;
+    }
+    while (data != SERIAL_INGEST_SYNC);
+
+    if (receive_ingest_frame_byte(&frame->type) == RETURN_CODE_FAILURE ||
+        receive_ingest_frame_byte(&frame->page) == RETURN_CODE_FAILURE ||
+        receive_ingest_frame_byte(&frame->length) == RETURN_CODE_FAILURE ||
+        frame->length > SPM_PAGESIZE)
+        return reject_ingest_frame(frame);
+
+    checksum = crc_lite_update(0, (uint8_t *)frame, sizeof(*frame));
+
+    for(uint8_t i = 0; i < frame->length; i++)
+    {
+        if (receive_ingest_frame_byte(&payload[i]) == RETURN_CODE_FAILURE)
+            return reject_ingest_frame(frame);
+        checksum = crc_lite_update(checksum, &payload[i], 1);
+    }
+
+    for(uint8_t i = 0; i < sizeof(received_checksum); i++)
+    {
+        if (receive_ingest_frame_byte(&data) == RETURN_CODE_FAILURE)
+            return reject_ingest_frame(frame);
+        received_checksum |= (uint32_t)data << (8 * i);
+    }
+
+    if (received_checksum != checksum)
+        return reject_ingest_frame(frame);
+
+    return RETURN_CODE_SUCCESS;
+}
+
+
+/**
+  Answer a frame with the status, its type and its page, so the host can
+  tell the answer to a repeated frame from the answer to the next one.
+
+  @param[in]        frame                 Frame to answer.
+  @param[in]        status                SERIAL_INGEST_ACK or SERIAL_INGEST_NAK.
+
+**/
+void send_ingest_reply(const ingest_frame_t *frame, uint8_t status)
+{
+    uint8_t reply[3] = {status, frame->type, frame->page};
+
+    for(uint8_t i = 0; i < sizeof(reply); i++)
+    {
+        while (!(UCSR0A & _BV(UDRE0)));
+        UDR0 = reply[i];
+    }
+}
+
+#endif
@@ -0,0 +1,127 @@
+/**
+  @file
+  iBootLoader - serial_ingest.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef SERIAL_INGEST_H
+#define SERIAL_INGEST_H
+
+#include <stdint.h>
+
+#ifndef SERIAL_INGEST_ENABLE
+#define SERIAL_INGEST_ENABLE 0
+#endif
+
+// 500 kBaud with U2X0, exact at 16 MHz.
+#define SERIAL_INGEST_BAUD            500000UL
+#define SERIAL_INGEST_UBRR            (F_CPU / 8 / SERIAL_INGEST_BAUD - 1)
+
+#define SERIAL_INGEST_WINDOW_MS       25      // Wait for a hello frame after reset.
+#define SERIAL_INGEST_TIMEOUT_MS      500     // Wait for the next frame of a session.
+#define SERIAL_INGEST_BYTE_TIMEOUT_MS 2       // Gap inside a frame.
+#define SERIAL_INGEST_HELLO_TRIES     4       // Frames taken in the window before giving up.
+
+#define SERIAL_INGEST_SYNC            0x7E
+#define SERIAL_INGEST_ACK             0x06
+#define SERIAL_INGEST_NAK             0x15
+
+#define SERIAL_INGEST_FRAME_INVALID   0x00
+#define SERIAL_INGEST_FRAME_HELLO     'H'
+#define SERIAL_INGEST_FRAME_PAGE      'P'
+#define SERIAL_INGEST_FRAME_END       'E'
+
+
+/*
+  A frame from the host:
+
+    sync                        SERIAL_INGEST_SYNC
+    type                        SERIAL_INGEST_FRAME_*
+    page                        Slot page of a page frame, 0 otherwise
+    length                      Payload length, at most SPM_PAGESIZE
+    payload                     length bytes
+    CRC-32                      4 bytes little endian, of type to payload
+
+  The bootloader answers every frame with ACK or NAK, the frame type and the
+  frame page. The exchange is stop-and-wait: the host sends the next frame
+  only after the answer and repeats a frame on NAK or timeout; a repeated
+  page is written again. The bootloader reads the UART only while it waits
+  for a frame, a byte sent before the answer is lost.
+*/
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t page;
+    uint8_t length;
+} ingest_frame_t;
+
+#if SERIAL_INGEST_ENABLE
+
+/**
+  Switch the UART to SERIAL_INGEST_BAUD. Pending serial output is sent first
+  at the boot baud rate.
+
+**/
+void open_serial_ingest();
+
+
+/**
+  Switch the UART back to the boot baud rate, or off if serial output is
+  disabled.
+
+**/
+void close_serial_ingest();
+
+
+/**
+  Receive one frame. A frame with a bad CRC or length is returned as
+  SERIAL_INGEST_FRAME_INVALID.
+
+  @param[out]       frame                 Type, page and payload length of the frame.
+  @param[out]       payload               Buffer of SPM_PAGESIZE bytes for the payload.
+  @param[in]        timeout_ms            Time to wait for the start of the frame.
+
+  @retval           RETURN_CODE_FAILURE   No frame started in time.
+  @retval           RETURN_CODE_SUCCESS   Frame received.
+
+**/
+uint8_t receive_ingest_frame(ingest_frame_t *frame, uint8_t *payload, uint16_t timeout_ms);
+
+
+/**
+  Answer a frame with the status, its type and its page, so the host can
+  tell the answer to a repeated frame from the answer to the next one.
+
+  @param[in]        frame                 Frame to answer.
+  @param[in]        status                SERIAL_INGEST_ACK or SERIAL_INGEST_NAK.
+
+**/
+void send_ingest_reply(const ingest_frame_t *frame, uint8_t status);
+
+#endif
+
+#endif //SERIAL_INGEST_H
@@ -35,6 +35,11 @@
 
 #if SERIAL_ENABLE
 
+#define SERIAL_TX_BUFFER_MASK (SERIAL_TX_BUFFER_SIZE - 1)
+
+static uint8_t tx_buffer[SERIAL_TX_BUFFER_SIZE];
+static uint8_t tx_head;
+static uint8_t tx_tail;
 
 /**
   Int to Ascii convertion library function. This code is copied from actual
@@ -102,9 +107,40 @@ void print_string(const char *message)
 {
     for(uint8_t i = 0; message[i] != '\0'; ++i)
     {
-        while (!(UCSR0A & (1 << UDRE0)));
-        UDR0 = message[i];
+        while (((tx_head + 1) & SERIAL_TX_BUFFER_MASK) == tx_tail)
+            service_serial_output();
+
+        tx_buffer[tx_head] = message[i];
+        tx_head = (tx_head + 1) & SERIAL_TX_BUFFER_MASK;
     }
+
+    service_serial_output();
+}
+
+
+/**
+  Move the next byte of the transmit ring to the UART if it can take one.
+  Called from the wait loops of the bus and flash drivers.
+
+**/
+void service_serial_output(void)
+{
+    if (tx_tail == tx_head || !(UCSR0A & (1 << UDRE0)))
+        return;
+
+    UDR0 = tx_buffer[tx_tail];
+    tx_tail = (tx_tail + 1) & SERIAL_TX_BUFFER_MASK;
+}
+
+
+/**
+  Wait until the transmit ring is empty.
+
+**/
+void flush_serial_output(void)
+{
+    while (tx_tail != tx_head)
+        service_serial_output();
 }
 
 
@@ -34,6 +34,9 @@
 #define SERIAL_ENABLE 0
 #endif
 
+// Transmit ring, a power of 2. Printing only blocks while the ring is full.
+#define SERIAL_TX_BUFFER_SIZE 64
+
 #if SERIAL_ENABLE
 
 /**
@@ -43,6 +46,21 @@
 void serial_setup(void);
 
 
+/**
+  Move the next byte of the transmit ring to the UART if it can take one.
+  Called from the wait loops of the bus and flash drivers.
+
+**/
+void service_serial_output(void);
+
+
+/**
+  Wait until the transmit ring is empty.
+
+**/
+void flush_serial_output(void);
+
+
 /**
   Print a string to the serial port.
 
@@ -69,13 +87,27 @@ void print_number(int value);
 #define serial_setup()
 
 
+/**
+  Move the next byte of the transmit ring to the UART if it can take one.
+
+**/
+#define service_serial_output()
+
+
+/**
+  Wait until the transmit ring is empty.
+
+**/
+#define flush_serial_output()
+
+
 /**
   Print a string to the serial port.
 
   @param[in]      message       const char pointer of the string.
 
 **/
-#define print_string(...)
+#define print_string(...) ((void)0)
 
 
 /**
@@ -84,7 +116,7 @@ void print_number(int value);
   @param[in]      value       Integer value.
 
 **/
-#define print_number(...)
+#define print_number(value) ((void)(value))
 
 #endif
 
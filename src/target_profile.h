@@ -0,0 +1,133 @@
+/**
+  @file
+  iBootLoader - target_profile.h
+
+  MIT License
+
+  @copyright
+  Copyright (c) 2020-2024 iAloy
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy
+  of this software and associated documentation files (the "Software"), to deal
+  in the Software without restriction, including without limitation the rights
+  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+  copies of the Software, and to permit persons to whom the Software is
+  furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all
+  copies or substantial portions of the Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+  SOFTWARE.
+**/
+
+
+#ifndef TARGET_PROFILE_H
+#define TARGET_PROFILE_H
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+/*
+  Slot geometry of the MCU and EEPROM the bootloader is built for. The MCU
+  comes from avr/io.h, the EEPROM from "eeprom" and "eeprom_count" in
+  config.json. The EEPROM holds slot 1, slot 2 and 32 pages for the config
+  region and the reserved space, in this order:
+
+    0                               Slot 1
+    EEPROM_FIRMWARE_SIZE            Slot 2
+    EEPROM_CONFIG_PAGE_NUMBER       Config, image headers, journal, config ring
+    EEPROM_RESERVED_PAGE_NUMBER     Boot timing ring
+
+  A slot is as large as the application flash, or half of the EEPROM left
+  after the 32 pages if that is less, and never larger than the 16 bit
+  lengths of image_header_t allow. Pages are SPM_PAGESIZE bytes, on the
+  EEPROM as in the flash.
+*/
+
+#define EEPROM_24LC512              1
+#define EEPROM_24LC1025             2
+
+#ifndef EEPROM_TYPE
+#define EEPROM_TYPE                 EEPROM_24LC512
+#endif
+
+#ifndef EEPROM_COUNT
+#define EEPROM_COUNT                1
+#endif
+
+#ifndef BOOTLOADER_SIZE
+#define BOOTLOADER_SIZE             4096
+#endif
+
+// Chips on one bus answer at EEPROM_I2C_ADDRESS + chip. The 24LC1025 takes the
+// upper 64 KB block through the B0 bit of its address and has only A1, A0.
+#if EEPROM_TYPE == EEPROM_24LC1025
+#define EEPROM_CHIP_SIZE            0x20000UL
+#define EEPROM_CHIP_SHIFT           17
+#define EEPROM_BLOCK_SELECT         0x04
+#define EEPROM_MAX_COUNT            4
+#else
+#define EEPROM_CHIP_SIZE            0x10000UL
+#define EEPROM_CHIP_SHIFT           16
+#define EEPROM_BLOCK_SELECT         0x00
+#define EEPROM_MAX_COUNT            8
+#endif
+
+#if EEPROM_COUNT < 1 || EEPROM_COUNT > EEPROM_MAX_COUNT
+#error "EEPROM_COUNT does not fit the address pins of the EEPROM"
+#endif
+
+#define EEPROM_PAGE_SIZE            128     // Write page of both chips.
+#define EEPROM_SIZE                 (EEPROM_CHIP_SIZE * EEPROM_COUNT)
+#define EEPROM_RESERVED_SIZE        (32UL * SPM_PAGESIZE)
+
+#define APP_FLASH_SIZE              (FLASHEND + 1UL - BOOTLOADER_SIZE)
+#define EEPROM_SLOT_LIMIT           ((EEPROM_SIZE - EEPROM_RESERVED_SIZE) / 2)
+#define IMAGE_LENGTH_LIMIT          (0x10000UL - SPM_PAGESIZE)
+
+#define EEPROM_FIRMWARE_SIZE_RAW    (APP_FLASH_SIZE < EEPROM_SLOT_LIMIT ? APP_FLASH_SIZE : EEPROM_SLOT_LIMIT)
+#define EEPROM_FIRMWARE_SIZE        ((EEPROM_FIRMWARE_SIZE_RAW < IMAGE_LENGTH_LIMIT ? \
+                                      EEPROM_FIRMWARE_SIZE_RAW : IMAGE_LENGTH_LIMIT) / SPM_PAGESIZE * SPM_PAGESIZE)
+#define FIRMWARE_MAX_PAGE           (EEPROM_FIRMWARE_SIZE / SPM_PAGESIZE)
+
+#define EEPROM_CONFIG_PAGE_NUMBER   (FIRMWARE_MAX_PAGE * 2)
+#define EEPROM_RESERVED_PAGE_NUMBER (EEPROM_CONFIG_PAGE_NUMBER + 16)
+
+// Flash page numbers and counters of a slot, one byte where the slot allows it.
+#if FIRMWARE_MAX_PAGE < 0xFF
+typedef uint8_t  flash_page_t;
+#else
+typedef uint16_t flash_page_t;
+#endif
+
+// Byte address on the EEPROM, above 16 bit for more than one 64 KB block.
+#if EEPROM_SIZE > 0x10000
+typedef uint32_t eeprom_address_t;
+#else
+typedef uint16_t eeprom_address_t;
+#endif
+
+// Byte address in the flash.
+#if FLASHEND > 0xFFFF
+typedef uint32_t flash_address_t;
+#else
+typedef uint16_t flash_address_t;
+#endif
+
+// Flash above 64 KB, where the bootloader and its tables are on larger parts, needs the far reads.
+#if FLASHEND > 0xFFFF
+#define read_flash_byte(address)            pgm_read_byte_far(address)
+#define read_flash_dword(table, index)      pgm_read_dword_far(pgm_get_far_address(table) + (index) * 4)
+#else
+#define read_flash_byte(address)            pgm_read_byte(address)
+#define read_flash_dword(table, index)      pgm_read_dword(&(table)[index])
+#endif
+
+#endif //TARGET_PROFILE_H
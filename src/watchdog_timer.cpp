@@ -56,3 +56,16 @@ void disable_watchdog_timer()
     WDTCSR = 0; // Clear everything, including WatchDogEnable
     sei();
 }
+
+
+/**
+  Reset the MCU with the shortest watchdog timeout. Does not return.
+
+**/
+void reset_by_watchdog_timer()
+{
+    enable_watchdog_timer(WATCHDOG_16MS);
+
+    // WDE stays set until the watchdog resets the MCU.
+    while (WDTCSR & _BV(WDE));
+}
@@ -61,4 +61,11 @@ void enable_watchdog_timer(const uint8_t wdtConfig);
 **/
 void disable_watchdog_timer();
 
+
+/**
+  Reset the MCU with the shortest watchdog timeout. Does not return.
+
+**/
+void reset_by_watchdog_timer();
+
 #endif  // WATCHDOG_TIMER_H